@@ -33,59 +33,46 @@ bool ShouldDoCosmeticFiltering(content::WebContents* contents,
   return ::brave_shields::ShouldDoCosmeticFiltering(map, url);
 }
 
-std::unique_ptr<base::ListValue> GetUrlCosmeticResourcesOnTaskRunner(
-    const std::string& url) {
-  auto result_list = std::make_unique<base::ListValue>();
+// Only the script to inject is used here, so it is the only part of the
+// merged resources handed back to the UI thread.
+std::string GetUrlCosmeticResourcesOnTaskRunner(const std::string& url) {
+  base::Optional<::brave_shields::CosmeticResources> resources =
+      g_brave_browser_process->ad_block_service()->UrlCosmeticResources(url);
 
-  base::Optional<base::Value> resources = g_brave_browser_process->
-      ad_block_service()->UrlCosmeticResources(url);
-
-  if (!resources || !resources->is_dict()) {
-    return result_list;
+  if (!resources) {
+    return std::string();
   }
 
-  base::Optional<base::Value> regional_resources = g_brave_browser_process->
-      ad_block_regional_service_manager()->UrlCosmeticResources(url);
+  base::Optional<::brave_shields::CosmeticResources> regional_resources =
+      g_brave_browser_process->ad_block_regional_service_manager()->
+          UrlCosmeticResources(url);
 
-  if (regional_resources && regional_resources->is_dict()) {
+  if (regional_resources) {
     ::brave_shields::MergeResourcesInto(
         std::move(*regional_resources), &*resources, /*force_hide=*/false);
   }
 
-  base::Optional<base::Value> custom_resources = g_brave_browser_process->
-      ad_block_custom_filters_service()->UrlCosmeticResources(url);
+  base::Optional<::brave_shields::CosmeticResources> custom_resources =
+      g_brave_browser_process->ad_block_custom_filters_service()->
+          UrlCosmeticResources(url);
 
-  if (custom_resources && custom_resources->is_dict()) {
+  if (custom_resources) {
     ::brave_shields::MergeResourcesInto(
         std::move(*custom_resources), &*resources, /*force_hide=*/true);
   }
 
-  result_list->Append(std::move(*resources));
-
-  return result_list;
+  return std::move(resources->injected_script);
 }
 
 void GetUrlCosmeticResourcesOnUI(content::GlobalFrameRoutingId frame_id,
-  std::unique_ptr<base::ListValue> resources) {
-  if (!resources) {
-    return;
-  }
-  for (auto i = resources->GetList().begin();
-      i < resources->GetList().end(); i++) {
-    base::DictionaryValue* resources_dict;
-    if (!i->GetAsDictionary(&resources_dict)) {
-      continue;
-    }
-    std::string to_inject;
-    resources_dict->GetString("injected_script", &to_inject);
-    if (to_inject.length() > 1) {
-      auto* frame_host = content::RenderFrameHost::FromID(frame_id);
-      if (!frame_host)
-        return;
-      frame_host->ExecuteJavaScriptInIsolatedWorld(
-          base::UTF8ToUTF16(to_inject),
-          base::NullCallback(), ISOLATED_WORLD_ID_CHROME_INTERNAL);
-    }
+  const std::string& to_inject) {
+  if (to_inject.length() > 1) {
+    auto* frame_host = content::RenderFrameHost::FromID(frame_id);
+    if (!frame_host)
+      return;
+    frame_host->ExecuteJavaScriptInIsolatedWorld(
+        base::UTF8ToUTF16(to_inject),
+        base::NullCallback(), ISOLATED_WORLD_ID_CHROME_INTERNAL);
   }
 }
 }  // namespace
@@ -3,10 +3,20 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this file,
  * You can obtain one at http://mozilla.org/MPL/2.0/. */
 
+#include <algorithm>
+
+#include "base/barrier_closure.h"
 #include "base/base64.h"
 #include "base/path_service.h"
+#include "base/run_loop.h"
+#include "base/strings/stringprintf.h"
+#include "base/system/sys_info.h"
 #include "base/task/post_task.h"
+#include "base/task/thread_pool/thread_pool_instance.h"
+#include "base/test/bind_test_util.h"
+#include "base/test/metrics/histogram_tester.h"
 #include "base/test/thread_test_helper.h"
+#include "base/timer/elapsed_timer.h"
 #include "brave/browser/brave_browser_process_impl.h"
 #include "brave/common/brave_paths.h"
 #include "brave/common/pref_names.h"
@@ -30,8 +40,11 @@
 #include "content/public/test/browser_test_utils.h"
 #include "extensions/test/extension_test_message_listener.h"
 #include "net/dns/mock_host_resolver.h"
+#include "testing/perf/perf_result_reporter.h"
 
+using brave_shields::features::kBraveAdblockCnameParallelCheck;
 using brave_shields::features::kBraveAdblockCosmeticFiltering;
+using brave_shields::features::kBraveAdblockParallelMatching;
 using content::BrowserThread;
 using extensions::ExtensionBrowserTest;
 
@@ -98,9 +111,25 @@ class AdBlockServiceTest : public ExtensionBrowserTest {
 
   void UpdateAdBlockInstanceWithRules(const std::string& rules,
                                       const std::string& resources = "") {
+    StartAdBlockInstanceUpdate(rules, resources);
+    WaitForAdBlockServiceThreads();
+  }
+
+  // Like UpdateAdBlockInstanceWithRules(), without waiting for the new engine
+  // to be published.
+  void StartAdBlockInstanceUpdate(const std::string& rules,
+                                  const std::string& resources) {
     g_brave_browser_process->ad_block_service()->ResetForTest(rules, resources);
   }
 
+  bool UpdateCustomFilters(const std::string& custom_filters) {
+    if (!g_brave_browser_process->ad_block_custom_filters_service()
+             ->UpdateCustomFilters(custom_filters))
+      return false;
+    WaitForAdBlockServiceThreads();
+    return true;
+  }
+
   void AssertTagExists(const std::string& tag, bool expected_exists) const {
     bool exists_default =
         g_brave_browser_process->ad_block_service()->TagExists(tag);
@@ -243,6 +272,10 @@ class AdBlockServiceTest : public ExtensionBrowserTest {
     scoped_refptr<base::ThreadTestHelper> tr_helper(new base::ThreadTestHelper(
         g_brave_browser_process->local_data_files_service()->GetTaskRunner()));
     ASSERT_TRUE(tr_helper->Run());
+    // Engines are built on the thread pool and then published back on the
+    // task runner.
+    base::ThreadPoolInstance::Get()->FlushForTesting();
+    ASSERT_TRUE(tr_helper->Run());
     scoped_refptr<base::ThreadTestHelper> io_helper(new base::ThreadTestHelper(
         base::CreateSingleThreadTaskRunner({BrowserThread::IO}).get()));
     ASSERT_TRUE(io_helper->Run());
@@ -281,8 +314,7 @@ IN_PROC_BROWSER_TEST_F(AdBlockServiceTest, AdsGetBlockedByDefaultBlocker) {
 // blocked by custom filters.
 IN_PROC_BROWSER_TEST_F(AdBlockServiceTest,
                        NotAdsDoNotGetBlockedByCustomBlocker) {
-  ASSERT_TRUE(g_brave_browser_process->ad_block_custom_filters_service()
-                  ->UpdateCustomFilters("*ad_banner.png"));
+  ASSERT_TRUE(UpdateCustomFilters("*ad_banner.png"));
 
   EXPECT_EQ(browser()->profile()->GetPrefs()->GetUint64(kAdsBlocked), 0ULL);
 
@@ -301,8 +333,7 @@ IN_PROC_BROWSER_TEST_F(AdBlockServiceTest,
 // filters.
 IN_PROC_BROWSER_TEST_F(AdBlockServiceTest, AdsGetBlockedByCustomBlocker) {
   EXPECT_EQ(browser()->profile()->GetPrefs()->GetUint64(kAdsBlocked), 0ULL);
-  ASSERT_TRUE(g_brave_browser_process->ad_block_custom_filters_service()
-                  ->UpdateCustomFilters("*ad_banner.png"));
+  ASSERT_TRUE(UpdateCustomFilters("*ad_banner.png"));
 
   GURL url = embedded_test_server()->GetURL(kAdBlockTestPage);
   ui_test_utils::NavigateToURL(browser(), url);
@@ -1015,3 +1046,510 @@ IN_PROC_BROWSER_TEST_F(AdBlockServiceTest,
 
   ASSERT_EQ(true, EvalJs(contents, "show_ad"));
 }
+
+// Batched matching must agree with matching requests one by one, across the
+// default and custom filter engines.
+IN_PROC_BROWSER_TEST_F(AdBlockServiceTest, ShouldStartRequestsMatchesSingle) {
+  UpdateAdBlockInstanceWithRules(
+      "*ad_banner.png\n"
+      "@@*ad_banner.png?allowed\n"
+      "||example.com/redirected.js$redirect=noopjs",
+      "[{\"name\": \"noopjs\", \"aliases\": [],"
+      "\"kind\": {\"mime\": \"application/javascript\"},"
+      "\"content\": \"KGZ1bmN0aW9uKCkgewogICd1c2Ugc3RyaWN0JzsKfSkoKTsK\"}]");
+  ASSERT_TRUE(UpdateCustomFilters("*custom_ad.png"));
+
+  const std::vector<brave_shields::AdBlockMatchRequest> requests = {
+      {GURL("https://example.com/ad_banner.png"),
+       blink::mojom::ResourceType::kImage, "example.com"},
+      {GURL("https://example.com/ad_banner.png?allowed"),
+       blink::mojom::ResourceType::kImage, "example.com"},
+      {GURL("https://example.com/logo.png"),
+       blink::mojom::ResourceType::kImage, "example.com"},
+      {GURL("https://example.com/custom_ad.png"),
+       blink::mojom::ResourceType::kImage, "example.com"},
+      {GURL("https://example.com/redirected.js"),
+       blink::mojom::ResourceType::kScript, "example.com"},
+  };
+
+  auto* ad_block_service = g_brave_browser_process->ad_block_service();
+  std::vector<brave_shields::AdBlockMatchResult> batched;
+  std::vector<brave_shields::AdBlockMatchResult> single(requests.size());
+  base::RunLoop run_loop;
+  ad_block_service->GetTaskRunner()->PostTaskAndReply(
+      FROM_HERE, base::BindLambdaForTesting([&]() {
+        batched = ad_block_service->ShouldStartRequests(requests);
+        for (size_t i = 0; i < requests.size(); ++i) {
+          single[i].should_start = ad_block_service->ShouldStartRequest(
+              requests[i].url, requests[i].resource_type,
+              requests[i].tab_host, &single[i].did_match_exception,
+              &single[i].mock_data_url);
+        }
+      }),
+      run_loop.QuitClosure());
+  run_loop.Run();
+
+  ASSERT_EQ(requests.size(), batched.size());
+  for (size_t i = 0; i < requests.size(); ++i) {
+    EXPECT_EQ(single[i].should_start, batched[i].should_start)
+        << requests[i].url;
+    EXPECT_EQ(single[i].did_match_exception, batched[i].did_match_exception)
+        << requests[i].url;
+    EXPECT_EQ(single[i].mock_data_url, batched[i].mock_data_url)
+        << requests[i].url;
+  }
+  EXPECT_FALSE(batched[0].should_start);
+  EXPECT_TRUE(batched[1].should_start);
+  EXPECT_TRUE(batched[1].did_match_exception);
+  EXPECT_TRUE(batched[2].should_start);
+  EXPECT_FALSE(batched[3].should_start);
+}
+
+// Load an image from a host that is an alias of a blocked host, and make sure
+// it is blocked once its canonical name is uncloaked.
+IN_PROC_BROWSER_TEST_F(AdBlockServiceTest, CnameCloakedRequestsGetBlocked) {
+  UpdateAdBlockInstanceWithRules("||tracker.com^");
+  host_resolver()->ClearRules();
+  host_resolver()->AddIPLiteralRule("cloaked.a.com", "127.0.0.1",
+                                    "ads.tracker.com");
+  host_resolver()->AddRule("*", "127.0.0.1");
+
+  GURL tab_url = embedded_test_server()->GetURL("a.com", kAdBlockTestPage);
+  GURL resource_url = embedded_test_server()->GetURL("cloaked.a.com",
+                                                     "/logo.png");
+  ui_test_utils::NavigateToURL(browser(), tab_url);
+  content::WebContents* contents =
+      browser()->tab_strip_model()->GetActiveWebContents();
+
+  ASSERT_EQ(true, EvalJs(contents,
+                         base::StringPrintf("setExpectations(0, 0, 1, 0, 0, 0);"
+                                            "addImage('%s')",
+                                            resource_url.spec().c_str())));
+  EXPECT_EQ(browser()->profile()->GetPrefs()->GetUint64(kAdsBlocked), 1ULL);
+
+  // The second request is answered from the canonical name cache.
+  base::HistogramTester histogram_tester;
+  ASSERT_EQ(true,
+            EvalJs(contents,
+                   base::StringPrintf("setExpectations(0, 0, 2, 0, 0, 0);"
+                                      "addImage('%s?again')",
+                                      resource_url.spec().c_str())));
+  EXPECT_EQ(browser()->profile()->GetPrefs()->GetUint64(kAdsBlocked), 2ULL);
+  histogram_tester.ExpectTotalCount(
+      "Brave.ShieldsCNAMEBlocking.TotalResolutionTime", 0);
+}
+
+class CnameParallelCheckTest : public AdBlockServiceTest {
+ public:
+  CnameParallelCheckTest() {
+    feature_list_.InitAndEnableFeature(kBraveAdblockCnameParallelCheck);
+  }
+
+ private:
+  base::test::ScopedFeatureList feature_list_;
+};
+
+// Matching the request URL while its CNAME is resolved must still block
+// cloaked requests, and must not wait for the resolution to block requests
+// the request URL alone decides.
+IN_PROC_BROWSER_TEST_F(CnameParallelCheckTest, CnameCloakedRequestsGetBlocked) {
+  UpdateAdBlockInstanceWithRules("||tracker.com^\n*ad_banner.png");
+  host_resolver()->ClearRules();
+  host_resolver()->AddIPLiteralRule("cloaked.a.com", "127.0.0.1",
+                                    "ads.tracker.com");
+  host_resolver()->AddIPLiteralRule("plain.a.com", "127.0.0.1",
+                                    "cdn.example.com");
+  host_resolver()->AddRule("*", "127.0.0.1");
+
+  GURL tab_url = embedded_test_server()->GetURL("a.com", kAdBlockTestPage);
+  ui_test_utils::NavigateToURL(browser(), tab_url);
+  content::WebContents* contents =
+      browser()->tab_strip_model()->GetActiveWebContents();
+
+  ASSERT_EQ(true,
+            EvalJs(contents,
+                   base::StringPrintf(
+                       "setExpectations(1, 0, 2, 0, 0, 0);"
+                       "Promise.all([addImage('%s'), addImage('%s'),"
+                       "             addImage('%s')])"
+                       "    .then(results => results.includes(true))",
+                       embedded_test_server()
+                           ->GetURL("cloaked.a.com", "/logo.png")
+                           .spec()
+                           .c_str(),
+                       embedded_test_server()
+                           ->GetURL("plain.a.com", "/ad_banner.png")
+                           .spec()
+                           .c_str(),
+                       embedded_test_server()
+                           ->GetURL("plain.a.com", "/logo.png")
+                           .spec()
+                           .c_str())));
+  EXPECT_EQ(browser()->profile()->GetPrefs()->GetUint64(kAdsBlocked), 2ULL);
+}
+
+// Loads images from aliased hosts through CNAME uncloaking, first with every
+// host resolved and then from the cache.
+IN_PROC_BROWSER_TEST_F(AdBlockServiceTest, CnameUncloakingReusesResolutions) {
+  const int kHostCount = 5;
+  UpdateAdBlockInstanceWithRules("||tracker.com^");
+  host_resolver()->ClearRules();
+  for (int i = 0; i < kHostCount; ++i) {
+    host_resolver()->AddIPLiteralRule(base::StringPrintf("host%d.a.com", i),
+                                      "127.0.0.1",
+                                      base::StringPrintf("host%d.cdn.com", i));
+  }
+  host_resolver()->AddRule("*", "127.0.0.1");
+
+  GURL tab_url = embedded_test_server()->GetURL("a.com", kAdBlockTestPage);
+  ui_test_utils::NavigateToURL(browser(), tab_url);
+  content::WebContents* contents =
+      browser()->tab_strip_model()->GetActiveWebContents();
+
+  auto load_images = [&](int expected_loaded, const std::string& query) {
+    std::string script = base::StringPrintf(
+        "setExpectations(%d, 0, 0, 0, 0, 0); Promise.all([", expected_loaded);
+    for (int i = 0; i < kHostCount; ++i) {
+      script += base::StringPrintf(
+          "addImage('%s'),",
+          embedded_test_server()
+              ->GetURL(base::StringPrintf("host%d.a.com", i),
+                       "/logo.png?" + query)
+              .spec()
+              .c_str());
+    }
+    script += "]).then(results => results.includes(true))";
+    return EvalJs(contents, script);
+  };
+
+  base::HistogramTester histogram_tester;
+  ASSERT_EQ(true, load_images(kHostCount, "cold"));
+  const int resolutions =
+      histogram_tester
+          .GetHistogramSamplesSinceCreation(
+              "Brave.ShieldsCNAMEBlocking.TotalResolutionTime")
+          ->TotalCount();
+  EXPECT_GE(resolutions, kHostCount);
+
+  ASSERT_EQ(true, load_images(2 * kHostCount, "cached"));
+  EXPECT_EQ(resolutions,
+            histogram_tester
+                .GetHistogramSamplesSinceCreation(
+                    "Brave.ShieldsCNAMEBlocking.TotalResolutionTime")
+                ->TotalCount());
+  EXPECT_EQ(browser()->profile()->GetPrefs()->GetUint64(kAdsBlocked), 0ULL);
+}
+
+// Measures the time it takes to load images from aliased hosts through CNAME
+// uncloaking, first with every host resolved and then from the cache. Only
+// run with --run-manual, as it reports perf results instead of checking
+// behavior.
+IN_PROC_BROWSER_TEST_F(AdBlockServiceTest, MANUAL_CnameUncloakingLatency) {
+  const int kHostCount = 50;
+  UpdateAdBlockInstanceWithRules("||tracker.com^");
+  host_resolver()->ClearRules();
+  for (int i = 0; i < kHostCount; ++i) {
+    host_resolver()->AddIPLiteralRule(base::StringPrintf("host%d.a.com", i),
+                                      "127.0.0.1",
+                                      base::StringPrintf("host%d.cdn.com", i));
+  }
+  host_resolver()->AddRule("*", "127.0.0.1");
+
+  GURL tab_url = embedded_test_server()->GetURL("a.com", kAdBlockTestPage);
+  ui_test_utils::NavigateToURL(browser(), tab_url);
+  content::WebContents* contents =
+      browser()->tab_strip_model()->GetActiveWebContents();
+
+  auto load_images = [&](int expected_loaded, const std::string& query) {
+    std::string script = base::StringPrintf(
+        "setExpectations(%d, 0, 0, 0, 0, 0); Promise.all([", expected_loaded);
+    for (int i = 0; i < kHostCount; ++i) {
+      script += base::StringPrintf(
+          "addImage('%s'),",
+          embedded_test_server()
+              ->GetURL(base::StringPrintf("host%d.a.com", i),
+                       "/logo.png?" + query)
+              .spec()
+              .c_str());
+    }
+    script += "]).then(results => results.includes(true))";
+    return EvalJs(contents, script);
+  };
+
+  base::HistogramTester histogram_tester;
+  base::ElapsedTimer cold_timer;
+  ASSERT_EQ(true, load_images(kHostCount, "cold"));
+  base::TimeDelta cold_time = cold_timer.Elapsed();
+  const int resolutions =
+      histogram_tester
+          .GetHistogramSamplesSinceCreation(
+              "Brave.ShieldsCNAMEBlocking.TotalResolutionTime")
+          ->TotalCount();
+  EXPECT_GE(resolutions, kHostCount);
+
+  base::ElapsedTimer cached_timer;
+  ASSERT_EQ(true, load_images(2 * kHostCount, "cached"));
+  base::TimeDelta cached_time = cached_timer.Elapsed();
+  EXPECT_EQ(resolutions,
+            histogram_tester
+                .GetHistogramSamplesSinceCreation(
+                    "Brave.ShieldsCNAMEBlocking.TotalResolutionTime")
+                ->TotalCount());
+  EXPECT_EQ(browser()->profile()->GetPrefs()->GetUint64(kAdsBlocked), 0ULL);
+
+  perf_test::PerfResultReporter reporter("AdBlockCnameUncloaking", "image");
+  reporter.RegisterImportantMetric(".resolved", "ms");
+  reporter.RegisterImportantMetric(".cached", "ms");
+  reporter.AddResult(".resolved", cold_time / kHostCount);
+  reporter.AddResult(".cached", cached_time / kHostCount);
+}
+
+// Requests keep being matched while the default and custom filter engines
+// are rebuilt over and over, and only the engines of the last update are
+// left in place.
+IN_PROC_BROWSER_TEST_F(AdBlockServiceTest, EngineUpdateStormKeepsLatestEngine) {
+  const int kRuleCount = 100;
+  const int kUpdateCount = 5;
+  const int kRequestsPerUpdate = 5;
+
+  auto make_rules = [&](int update) {
+    std::string rules;
+    for (int i = 0; i < kRuleCount; ++i)
+      rules += base::StringPrintf("||ads%d-%d.com^\n", update, i);
+    return rules;
+  };
+
+  auto* ad_block_service = g_brave_browser_process->ad_block_service();
+  int matched = 0;
+  for (int update = 0; update < kUpdateCount; ++update) {
+    StartAdBlockInstanceUpdate(make_rules(update), "");
+    ASSERT_TRUE(g_brave_browser_process->ad_block_custom_filters_service()
+                    ->UpdateCustomFilters(make_rules(update + kUpdateCount)));
+    for (int i = 0; i < kRequestsPerUpdate; ++i) {
+      GURL url(base::StringPrintf("https://ads%d-%d.com/ad.png", update, i));
+      ad_block_service->GetTaskRunner()->PostTask(
+          FROM_HERE, base::BindLambdaForTesting([&, url]() {
+            ad_block_service->ShouldStartRequest(
+                url, blink::mojom::ResourceType::kImage, "example.com",
+                nullptr, nullptr);
+            matched++;
+          }));
+    }
+  }
+  WaitForAdBlockServiceThreads();
+
+  ASSERT_EQ(kUpdateCount * kRequestsPerUpdate, matched);
+
+  bool last_blocked = false;
+  bool previous_blocked = true;
+  base::RunLoop run_loop;
+  ad_block_service->GetTaskRunner()->PostTaskAndReply(
+      FROM_HERE, base::BindLambdaForTesting([&]() {
+        last_blocked = !ad_block_service->ShouldStartRequest(
+            GURL(base::StringPrintf("https://ads%d-0.com/ad.png",
+                                    kUpdateCount - 1)),
+            blink::mojom::ResourceType::kImage, "example.com", nullptr,
+            nullptr);
+        previous_blocked = !ad_block_service->ShouldStartRequest(
+            GURL(base::StringPrintf("https://ads%d-0.com/ad.png",
+                                    kUpdateCount - 2)),
+            blink::mojom::ResourceType::kImage, "example.com", nullptr,
+            nullptr);
+      }),
+      run_loop.QuitClosure());
+  run_loop.Run();
+  EXPECT_TRUE(last_blocked);
+  EXPECT_FALSE(previous_blocked);
+}
+
+// Measures how long requests wait to be matched while the default and custom
+// filter engines are rebuilt over and over, from the time a request is handed
+// to the adblock task runner until its decision is made. Only run with
+// --run-manual.
+IN_PROC_BROWSER_TEST_F(AdBlockServiceTest, MANUAL_EngineUpdateStormLatency) {
+  const int kRuleCount = 20000;
+  const int kUpdateCount = 10;
+  const int kRequestsPerUpdate = 50;
+
+  auto make_rules = [&](int update) {
+    std::string rules;
+    for (int i = 0; i < kRuleCount; ++i)
+      rules += base::StringPrintf("||ads%d-%d.com^\n", update, i);
+    return rules;
+  };
+
+  auto* ad_block_service = g_brave_browser_process->ad_block_service();
+  std::vector<base::TimeDelta> latencies;
+  for (int update = 0; update < kUpdateCount; ++update) {
+    StartAdBlockInstanceUpdate(make_rules(update), "");
+    ASSERT_TRUE(g_brave_browser_process->ad_block_custom_filters_service()
+                    ->UpdateCustomFilters(make_rules(update + kUpdateCount)));
+    for (int i = 0; i < kRequestsPerUpdate; ++i) {
+      GURL url(base::StringPrintf("https://ads%d-%d.com/ad.png", update, i));
+      ad_block_service->GetTaskRunner()->PostTask(
+          FROM_HERE,
+          base::BindOnce(
+              [](brave_shields::AdBlockService* service, const GURL& url,
+                 base::TimeTicks posted,
+                 std::vector<base::TimeDelta>* latencies) {
+                service->ShouldStartRequest(url,
+                                            blink::mojom::ResourceType::kImage,
+                                            "example.com", nullptr, nullptr);
+                latencies->push_back(base::TimeTicks::Now() - posted);
+              },
+              ad_block_service, url, base::TimeTicks::Now(), &latencies));
+    }
+  }
+  WaitForAdBlockServiceThreads();
+
+  ASSERT_EQ(static_cast<size_t>(kUpdateCount * kRequestsPerUpdate),
+            latencies.size());
+
+  // Only the engines of the last update are left in place.
+  bool last_blocked = false;
+  bool previous_blocked = true;
+  base::RunLoop run_loop;
+  ad_block_service->GetTaskRunner()->PostTaskAndReply(
+      FROM_HERE, base::BindLambdaForTesting([&]() {
+        last_blocked = !ad_block_service->ShouldStartRequest(
+            GURL(base::StringPrintf("https://ads%d-0.com/ad.png",
+                                    kUpdateCount - 1)),
+            blink::mojom::ResourceType::kImage, "example.com", nullptr,
+            nullptr);
+        previous_blocked = !ad_block_service->ShouldStartRequest(
+            GURL(base::StringPrintf("https://ads%d-0.com/ad.png",
+                                    kUpdateCount - 2)),
+            blink::mojom::ResourceType::kImage, "example.com", nullptr,
+            nullptr);
+      }),
+      run_loop.QuitClosure());
+  run_loop.Run();
+  EXPECT_TRUE(last_blocked);
+  EXPECT_FALSE(previous_blocked);
+  std::sort(latencies.begin(), latencies.end());
+  perf_test::PerfResultReporter reporter("AdBlockEngineUpdateStorm",
+                                         "should_start_request");
+  reporter.RegisterImportantMetric(".p50", "ms");
+  reporter.RegisterImportantMetric(".p99", "ms");
+  reporter.AddResult(".p50", latencies[latencies.size() / 2]);
+  reporter.AddResult(".p99", latencies[latencies.size() * 99 / 100]);
+}
+
+class ParallelMatchingTest : public AdBlockServiceTest {
+ public:
+  ParallelMatchingTest() {
+    feature_list_.InitAndEnableFeature(kBraveAdblockParallelMatching);
+  }
+
+ private:
+  base::test::ScopedFeatureList feature_list_;
+};
+
+// Requests matched on the matching sequences must get the same decisions as
+// on the adblock task runner, across the default and custom filter engines.
+IN_PROC_BROWSER_TEST_F(ParallelMatchingTest, AdsGetBlocked) {
+  UpdateAdBlockInstanceWithRules("*ad_banner.png\n@@*ad_banner.png?allowed");
+  ASSERT_TRUE(UpdateCustomFilters("*custom_ad.png"));
+
+  const std::vector<brave_shields::AdBlockMatchRequest> requests = {
+      {GURL("https://example.com/ad_banner.png"),
+       blink::mojom::ResourceType::kImage, "example.com"},
+      {GURL("https://example.com/ad_banner.png?allowed"),
+       blink::mojom::ResourceType::kImage, "example.com"},
+      {GURL("https://example.com/logo.png"),
+       blink::mojom::ResourceType::kImage, "example.com"},
+      {GURL("https://example.com/custom_ad.png"),
+       blink::mojom::ResourceType::kImage, "example.com"},
+  };
+
+  auto* ad_block_service = g_brave_browser_process->ad_block_service();
+  auto match_on = [&](scoped_refptr<base::SequencedTaskRunner> task_runner) {
+    std::vector<brave_shields::AdBlockMatchResult> results;
+    base::RunLoop run_loop;
+    task_runner->PostTaskAndReply(
+        FROM_HERE, base::BindLambdaForTesting([&]() {
+          results = ad_block_service->ShouldStartRequests(requests);
+        }),
+        run_loop.QuitClosure());
+    run_loop.Run();
+    return results;
+  };
+  std::vector<brave_shields::AdBlockMatchResult> sequenced =
+      match_on(ad_block_service->GetTaskRunner());
+  std::vector<brave_shields::AdBlockMatchResult> parallel =
+      match_on(ad_block_service->GetMatchingTaskRunner());
+  ASSERT_NE(ad_block_service->GetTaskRunner(),
+            ad_block_service->GetMatchingTaskRunner());
+
+  ASSERT_EQ(requests.size(), parallel.size());
+  for (size_t i = 0; i < requests.size(); ++i) {
+    EXPECT_EQ(sequenced[i].should_start, parallel[i].should_start)
+        << requests[i].url;
+    EXPECT_EQ(sequenced[i].did_match_exception,
+              parallel[i].did_match_exception)
+        << requests[i].url;
+  }
+  EXPECT_FALSE(parallel[0].should_start);
+  EXPECT_TRUE(parallel[1].did_match_exception);
+  EXPECT_TRUE(parallel[2].should_start);
+  EXPECT_FALSE(parallel[3].should_start);
+
+  GURL url = embedded_test_server()->GetURL(kAdBlockTestPage);
+  ui_test_utils::NavigateToURL(browser(), url);
+  content::WebContents* contents =
+      browser()->tab_strip_model()->GetActiveWebContents();
+  ASSERT_EQ(true, EvalJs(contents,
+                         "setExpectations(0, 0, 1, 0, 0, 0);"
+                         "addImage('ad_banner.png')"));
+  EXPECT_EQ(browser()->profile()->GetPrefs()->GetUint64(kAdsBlocked), 1ULL);
+}
+
+// Measures ShouldStartRequests throughput with an increasing number of
+// sequences matching batches concurrently, up to one per core. Only run with
+// --run-manual.
+IN_PROC_BROWSER_TEST_F(ParallelMatchingTest,
+                       MANUAL_ShouldStartRequestsThroughput) {
+  const int kRuleCount = 20000;
+  const int kBatchSize = 50;
+  const int kBatchesPerSequence = 200;
+
+  std::string rules;
+  for (int i = 0; i < kRuleCount; ++i)
+    rules += base::StringPrintf("||ads%d.com^\n", i);
+  UpdateAdBlockInstanceWithRules(rules);
+
+  std::vector<brave_shields::AdBlockMatchRequest> requests;
+  for (int i = 0; i < kBatchSize; ++i) {
+    requests.emplace_back(
+        GURL(base::StringPrintf("https://cdn%d.example.com/script.js", i)),
+        blink::mojom::ResourceType::kScript, "example.com");
+  }
+
+  auto* ad_block_service = g_brave_browser_process->ad_block_service();
+  perf_test::PerfResultReporter reporter("AdBlockParallelMatching",
+                                         "should_start_requests");
+  const int max_sequences = base::SysInfo::NumberOfProcessors();
+  for (int sequences = 1; sequences <= max_sequences; sequences *= 2) {
+    base::RunLoop run_loop;
+    base::RepeatingClosure done =
+        base::BarrierClosure(sequences, run_loop.QuitClosure());
+    base::ElapsedTimer timer;
+    for (int i = 0; i < sequences; ++i) {
+      base::CreateSequencedTaskRunner({base::ThreadPool()})
+          ->PostTaskAndReply(FROM_HERE, base::BindLambdaForTesting([&]() {
+                               for (int j = 0; j < kBatchesPerSequence; ++j)
+                                 ad_block_service->ShouldStartRequests(
+                                     requests);
+                             }),
+                             done);
+    }
+    run_loop.Run();
+    base::TimeDelta elapsed = timer.Elapsed();
+
+    const std::string story = base::StringPrintf(".sequences_%d", sequences);
+    reporter.RegisterImportantMetric(story, "requests/ms");
+    reporter.AddResult(story,
+                       sequences * kBatchesPerSequence * kBatchSize /
+                           elapsed.InMillisecondsF());
+  }
+}
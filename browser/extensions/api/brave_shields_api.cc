@@ -5,7 +5,9 @@
 
 #include "brave/browser/extensions/api/brave_shields_api.h"
 
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "base/strings/string_number_conversions.h"
 #include "brave/browser/brave_browser_process_impl.h"
@@ -20,6 +22,7 @@
 #include "brave/components/brave_shields/browser/brave_shields_p3a.h"
 #include "brave/components/brave_shields/browser/brave_shields_util.h"
 #include "brave/components/brave_shields/browser/brave_shields_web_contents_observer.h"
+#include "brave/components/brave_shields/browser/hidden_class_id_sessions.h"
 #include "brave/components/brave_shields/common/brave_shield_constants.h"
 #include "chrome/browser/browser_process.h"
 #include "chrome/browser/content_settings/host_content_settings_map_factory.h"
@@ -44,6 +47,13 @@ namespace {
 const char kInvalidUrlError[] = "Invalid URL.";
 const char kInvalidControlTypeError[] = "Invalid ControlType.";
 
+base::Value ToListValue(std::vector<std::string> strings) {
+  base::Value list(base::Value::Type::LIST);
+  for (auto& string : strings)
+    list.Append(base::Value(std::move(string)));
+  return list;
+}
+
 }  // namespace
 
 
@@ -57,7 +67,9 @@ BraveShieldsUrlCosmeticResourcesFunction::Run() {
           FROM_HERE,
           base::BindOnce(&BraveShieldsUrlCosmeticResourcesFunction::
                              GetUrlCosmeticResourcesOnTaskRunner,
-                         this, params->url),
+                         this, params->url,
+                         params->tab_id ? *params->tab_id : -1,
+                         params->frame_id ? *params->frame_id : -1),
           base::BindOnce(&BraveShieldsUrlCosmeticResourcesFunction::
                              GetUrlCosmeticResourcesOnUI,
                          this));
@@ -65,32 +77,44 @@ BraveShieldsUrlCosmeticResourcesFunction::Run() {
 }
 
 std::unique_ptr<base::ListValue> BraveShieldsUrlCosmeticResourcesFunction::
-    GetUrlCosmeticResourcesOnTaskRunner(const std::string& url) {
-  base::Optional<base::Value> resources = g_brave_browser_process->
-      ad_block_service()->UrlCosmeticResources(url);
+    GetUrlCosmeticResourcesOnTaskRunner(const std::string& url,
+                                        int tab_id,
+                                        int frame_id) {
+  auto* ad_block_service = g_brave_browser_process->ad_block_service();
+  if (tab_id >= 0 && frame_id >= 0) {
+    // A newly loaded content script has none of the hidden class and id
+    // selectors applied yet, even if its document already queried them.
+    ad_block_service->hidden_class_id_sessions()->ResetFrame(tab_id,
+                                                             frame_id);
+  }
 
-  if (!resources || !resources->is_dict()) {
+  base::Optional<::brave_shields::CosmeticResources> resources =
+      ad_block_service->UrlCosmeticResources(url);
+
+  if (!resources) {
     return std::unique_ptr<base::ListValue>();
   }
 
-  base::Optional<base::Value> regional_resources = g_brave_browser_process->
-      ad_block_regional_service_manager()->UrlCosmeticResources(url);
+  base::Optional<::brave_shields::CosmeticResources> regional_resources =
+      g_brave_browser_process->ad_block_regional_service_manager()->
+          UrlCosmeticResources(url);
 
-  if (regional_resources && regional_resources->is_dict()) {
+  if (regional_resources) {
     ::brave_shields::MergeResourcesInto(
         std::move(*regional_resources), &*resources, /*force_hide=*/false);
   }
 
-  base::Optional<base::Value> custom_resources = g_brave_browser_process->
-      ad_block_custom_filters_service()->UrlCosmeticResources(url);
+  base::Optional<::brave_shields::CosmeticResources> custom_resources =
+      g_brave_browser_process->ad_block_custom_filters_service()->
+          UrlCosmeticResources(url);
 
-  if (custom_resources && custom_resources->is_dict()) {
+  if (custom_resources) {
     ::brave_shields::MergeResourcesInto(
         std::move(*custom_resources), &*resources, /*force_hide=*/true);
   }
 
   auto result_list = std::make_unique<base::ListValue>();
-  result_list->Append(std::move(*resources));
+  result_list->Append(resources->TakeValue());
   return result_list;
 }
 
@@ -108,13 +132,15 @@ BraveShieldsHiddenClassIdSelectorsFunction::Run() {
   std::unique_ptr<brave_shields::HiddenClassIdSelectors::Params> params(
       brave_shields::HiddenClassIdSelectors::Params::Create(*args_));
   EXTENSION_FUNCTION_VALIDATE(params.get());
+  tab_id_ = params->tab_id ? *params->tab_id : -1;
+  frame_id_ = params->frame_id ? *params->frame_id : -1;
   g_brave_browser_process->ad_block_service()->GetTaskRunner()
       ->PostTaskAndReplyWithResult(
           FROM_HERE,
           base::BindOnce(&BraveShieldsHiddenClassIdSelectorsFunction::
                              GetHiddenClassIdSelectorsOnTaskRunner,
-                         this, params->classes, params->ids,
-                         params->exceptions),
+                         this, std::move(params->classes),
+                         std::move(params->ids), params->exceptions),
           base::BindOnce(&BraveShieldsHiddenClassIdSelectorsFunction::
                              GetHiddenClassIdSelectorsOnUI,
                          this));
@@ -123,46 +149,49 @@ BraveShieldsHiddenClassIdSelectorsFunction::Run() {
 
 std::unique_ptr<base::ListValue> BraveShieldsHiddenClassIdSelectorsFunction::
     GetHiddenClassIdSelectorsOnTaskRunner(
-        const std::vector<std::string>& classes,
-        const std::vector<std::string>& ids,
+        std::vector<std::string> classes,
+        std::vector<std::string> ids,
         const std::vector<std::string>& exceptions) {
-  base::Optional<base::Value> hide_selectors = g_brave_browser_process->
-      ad_block_service()->HiddenClassIdSelectors(classes, ids, exceptions);
-
-  base::Optional<base::Value> regional_selectors = g_brave_browser_process->
-      ad_block_regional_service_manager()->
-          HiddenClassIdSelectors(classes, ids, exceptions);
-
-  base::Optional<base::Value> custom_selectors = g_brave_browser_process->
-      ad_block_custom_filters_service()->
-          HiddenClassIdSelectors(classes, ids, exceptions);
-
-  if (hide_selectors && hide_selectors->is_list()) {
-    if (regional_selectors && regional_selectors->is_list()) {
-      for (auto i = regional_selectors->GetList().begin();
-              i < regional_selectors->GetList().end();
-              i++) {
-        hide_selectors->Append(std::move(*i));
-      }
-    }
-  } else {
-    hide_selectors = std::move(regional_selectors);
+  auto* ad_block_service = g_brave_browser_process->ad_block_service();
+  if (tab_id_ >= 0 && frame_id_ >= 0) {
+    ad_block_service->hidden_class_id_sessions()->FilterNewTokens(
+        tab_id_, frame_id_, &classes, &ids);
   }
 
-  auto result_list = std::make_unique<base::ListValue>();
-  if (hide_selectors && hide_selectors->is_list()) {
-    result_list->Append(std::move(*hide_selectors));
-  }
-  if (custom_selectors && custom_selectors->is_list()) {
-    result_list->Append(std::move(*custom_selectors));
+  std::vector<std::string> hide_selectors;
+  std::vector<std::string> custom_selectors;
+  if (!classes.empty() || !ids.empty()) {
+    hide_selectors =
+        ad_block_service->HiddenClassIdSelectors(classes, ids, exceptions);
+
+    ::brave_shields::MergeSelectorsInto(
+        g_brave_browser_process->ad_block_regional_service_manager()->
+            HiddenClassIdSelectors(classes, ids, exceptions),
+        &hide_selectors);
+
+    custom_selectors = g_brave_browser_process->
+        ad_block_custom_filters_service()->
+            HiddenClassIdSelectors(classes, ids, exceptions);
   }
 
+  auto result_list = std::make_unique<base::ListValue>();
+  result_list->Append(ToListValue(std::move(hide_selectors)));
+  result_list->Append(ToListValue(std::move(custom_selectors)));
+
+  matched_classes_ = std::move(classes);
+  matched_ids_ = std::move(ids);
   return result_list;
 }
 
 void BraveShieldsHiddenClassIdSelectorsFunction::
     GetHiddenClassIdSelectorsOnUI(std::unique_ptr<base::ListValue> selectors) {
   Respond(ArgumentList(std::move(selectors)));
+  if (tab_id_ >= 0 && frame_id_ >= 0 &&
+      (!matched_classes_.empty() || !matched_ids_.empty())) {
+    g_brave_browser_process->ad_block_service()->OnHiddenClassIdSelectorsSent(
+        tab_id_, frame_id_, std::move(matched_classes_),
+        std::move(matched_ids_));
+  }
 }
 
 
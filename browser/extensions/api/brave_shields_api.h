@@ -25,8 +25,12 @@ class BraveShieldsUrlCosmeticResourcesFunction : public ExtensionFunction {
   ResponseAction Run() override;
 
  private:
+  // When |tab_id| and |frame_id| are valid, the hidden class and id session
+  // of the frame is restarted.
   std::unique_ptr<base::ListValue> GetUrlCosmeticResourcesOnTaskRunner(
-      const std::string& url);
+      const std::string& url,
+      int tab_id,
+      int frame_id);
   void GetUrlCosmeticResourcesOnUI(std::unique_ptr<base::ListValue> resources);
 };
 
@@ -40,12 +44,21 @@ class BraveShieldsHiddenClassIdSelectorsFunction : public ExtensionFunction {
   ResponseAction Run() override;
 
  private:
+  // When |tab_id_| and |frame_id_| are valid, only classes and ids whose
+  // selectors were not sent to the frame yet are matched.
   std::unique_ptr<base::ListValue> GetHiddenClassIdSelectorsOnTaskRunner(
-      const std::vector<std::string>& classes,
-      const std::vector<std::string>& ids,
+      std::vector<std::string> classes,
+      std::vector<std::string> ids,
       const std::vector<std::string>& exceptions);
+  // Responds, then has the frame's session remember the matched tokens.
   void GetHiddenClassIdSelectorsOnUI(
       std::unique_ptr<base::ListValue> selectors);
+
+  int tab_id_ = -1;
+  int frame_id_ = -1;
+  // Set on the task runner, read on the UI thread once its reply runs.
+  std::vector<std::string> matched_classes_;
+  std::vector<std::string> matched_ids_;
 };
 
 class BraveShieldsAllowScriptsOnceFunction : public ExtensionFunction {
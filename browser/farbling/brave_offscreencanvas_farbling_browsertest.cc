@@ -30,9 +30,9 @@ using brave_shields::ControlType;
 
 const char kEmbeddedTestServerDirectory[] = "canvas";
 const char kTitleScript[] = "domAutomationController.send(document.title);";
-const char kExpectedImageDataHashFarblingBalanced[] = "85";
+const char kExpectedImageDataHashFarblingBalanced[] = "92";
 const char kExpectedImageDataHashFarblingOff[] = "0";
-const char kExpectedImageDataHashFarblingMaximum[] = "85";
+const char kExpectedImageDataHashFarblingMaximum[] = "92";
 
 class BraveOffscreenCanvasFarblingBrowserTest : public InProcessBrowserTest {
  public:
@@ -0,0 +1,91 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/browser/net/ad_block_cname_cache.h"
+
+#include "base/metrics/histogram_macros.h"
+#include "base/no_destructor.h"
+#include "base/time/default_tick_clock.h"
+#include "brave/components/brave_shields/common/features.h"
+
+namespace brave {
+
+namespace {
+
+// Lookups between two reports of the hit rate.
+const uint64_t kMetricsInterval = 1000;
+
+}  // namespace
+
+AdBlockCnameCache::AdBlockCnameCache(size_t max_size,
+                                     base::TimeDelta ttl,
+                                     const base::TickClock* tick_clock)
+    : ttl_(ttl),
+      tick_clock_(tick_clock),
+      entries_(max_size),
+      lookups_(0),
+      hits_(0) {
+  DETACH_FROM_SEQUENCE(sequence_checker_);
+}
+
+AdBlockCnameCache::~AdBlockCnameCache() = default;
+
+// static
+AdBlockCnameCache* AdBlockCnameCache::GetInstance() {
+  namespace features = brave_shields::features;
+  static base::NoDestructor<AdBlockCnameCache> instance(
+      features::kBraveAdblockCnameCacheSize.Get(),
+      base::TimeDelta::FromSeconds(
+          features::kBraveAdblockCnameCacheTtlSeconds.Get()),
+      base::DefaultTickClock::GetInstance());
+  return instance.get();
+}
+
+bool AdBlockCnameCache::Get(const std::string& host,
+                            std::string* canonical_name) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  auto it = entries_.Get(host);
+  if (it == entries_.end()) {
+    RecordLookup(false);
+    return false;
+  }
+  if (it->second.expiration <= tick_clock_->NowTicks()) {
+    entries_.Erase(it);
+    RecordLookup(false);
+    return false;
+  }
+
+  *canonical_name = it->second.canonical_name;
+  RecordLookup(true);
+  return true;
+}
+
+void AdBlockCnameCache::Put(const std::string& host,
+                            const std::string& canonical_name) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (ttl_.is_zero())
+    return;
+  entries_.Put(host, {canonical_name, tick_clock_->NowTicks() + ttl_});
+}
+
+void AdBlockCnameCache::Clear() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  entries_.Clear();
+}
+
+void AdBlockCnameCache::RecordLookup(bool hit) {
+  lookups_++;
+  if (hit)
+    hits_++;
+  if (lookups_ < kMetricsInterval)
+    return;
+
+  UMA_HISTOGRAM_PERCENTAGE("Brave.ShieldsCNAMEBlocking.CacheHitRate",
+                           static_cast<int>(100 * hits_ / lookups_));
+  lookups_ = 0;
+  hits_ = 0;
+}
+
+}  // namespace brave
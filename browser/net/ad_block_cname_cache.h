@@ -0,0 +1,66 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_BROWSER_NET_AD_BLOCK_CNAME_CACHE_H_
+#define BRAVE_BROWSER_NET_AD_BLOCK_CNAME_CACHE_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "base/containers/mru_cache.h"
+#include "base/macros.h"
+#include "base/sequence_checker.h"
+#include "base/time/time.h"
+
+namespace base {
+class TickClock;
+}
+
+namespace brave {
+
+// Canonical names resolved for CNAME uncloaking, shared by every tab so a
+// host only has to be resolved again once its entry expires. An empty
+// canonical name means the host is not an alias and is cached as well, only
+// failed resolutions are not.
+//
+// Must be used on the UI thread.
+class AdBlockCnameCache {
+ public:
+  AdBlockCnameCache(size_t max_size,
+                    base::TimeDelta ttl,
+                    const base::TickClock* tick_clock);
+  ~AdBlockCnameCache();
+
+  static AdBlockCnameCache* GetInstance();
+
+  bool Get(const std::string& host, std::string* canonical_name);
+  void Put(const std::string& host, const std::string& canonical_name);
+  void Clear();
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    std::string canonical_name;
+    base::TimeTicks expiration;
+  };
+
+  void RecordLookup(bool hit);
+
+  const base::TimeDelta ttl_;
+  const base::TickClock* tick_clock_;
+  base::HashingMRUCache<std::string, Entry> entries_;
+  uint64_t lookups_;
+  uint64_t hits_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+
+  DISALLOW_COPY_AND_ASSIGN(AdBlockCnameCache);
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_BROWSER_NET_AD_BLOCK_CNAME_CACHE_H_
@@ -0,0 +1,72 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/browser/net/ad_block_cname_cache.h"
+
+#include <string>
+
+#include "base/test/simple_test_tick_clock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using brave::AdBlockCnameCache;
+
+TEST(AdBlockCnameCacheTest, StoresCanonicalNames) {
+  base::SimpleTestTickClock clock;
+  AdBlockCnameCache cache(10, base::TimeDelta::FromSeconds(60), &clock);
+  cache.Put("cloaked.example.com", "tracker.net");
+  cache.Put("plain.example.com", "");
+
+  std::string canonical_name;
+  ASSERT_TRUE(cache.Get("cloaked.example.com", &canonical_name));
+  EXPECT_EQ("tracker.net", canonical_name);
+  // Hosts that are not aliases are remembered too.
+  ASSERT_TRUE(cache.Get("plain.example.com", &canonical_name));
+  EXPECT_EQ("", canonical_name);
+  EXPECT_FALSE(cache.Get("other.example.com", &canonical_name));
+}
+
+TEST(AdBlockCnameCacheTest, EntriesExpire) {
+  base::SimpleTestTickClock clock;
+  AdBlockCnameCache cache(10, base::TimeDelta::FromSeconds(60), &clock);
+  cache.Put("cloaked.example.com", "tracker.net");
+
+  std::string canonical_name;
+  clock.Advance(base::TimeDelta::FromSeconds(59));
+  EXPECT_TRUE(cache.Get("cloaked.example.com", &canonical_name));
+  clock.Advance(base::TimeDelta::FromSeconds(1));
+  EXPECT_FALSE(cache.Get("cloaked.example.com", &canonical_name));
+  EXPECT_EQ(0u, cache.size());
+
+  // Refreshing an entry restarts its lifetime.
+  cache.Put("cloaked.example.com", "other-tracker.net");
+  clock.Advance(base::TimeDelta::FromSeconds(30));
+  ASSERT_TRUE(cache.Get("cloaked.example.com", &canonical_name));
+  EXPECT_EQ("other-tracker.net", canonical_name);
+}
+
+TEST(AdBlockCnameCacheTest, IsBounded) {
+  base::SimpleTestTickClock clock;
+  AdBlockCnameCache cache(2, base::TimeDelta::FromSeconds(60), &clock);
+  cache.Put("a.com", "");
+  cache.Put("b.com", "");
+  cache.Put("c.com", "");
+  EXPECT_EQ(2u, cache.size());
+
+  std::string canonical_name;
+  EXPECT_FALSE(cache.Get("a.com", &canonical_name));
+  EXPECT_TRUE(cache.Get("c.com", &canonical_name));
+
+  cache.Clear();
+  EXPECT_EQ(0u, cache.size());
+}
+
+TEST(AdBlockCnameCacheTest, ZeroTtlDisablesCaching) {
+  base::SimpleTestTickClock clock;
+  AdBlockCnameCache cache(10, base::TimeDelta(), &clock);
+  cache.Put("cloaked.example.com", "tracker.net");
+
+  std::string canonical_name;
+  EXPECT_FALSE(cache.Get("cloaked.example.com", &canonical_name));
+}
@@ -11,16 +11,26 @@
 #include <vector>
 
 #include "base/base64url.h"
+#include "base/feature_list.h"
+#include "base/metrics/histogram_macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/no_destructor.h"
 #include "base/strings/string_util.h"
+#include "base/synchronization/lock.h"
+#include "base/task/post_task.h"
+#include "base/trace_event/trace_event.h"
 #include "brave/browser/brave_browser_process_impl.h"
+#include "brave/browser/net/ad_block_cname_cache.h"
 #include "brave/browser/net/url_context.h"
 #include "brave/common/network_constants.h"
 #include "brave/components/brave_shields/browser/ad_block_service.h"
 #include "brave/components/brave_shields/browser/brave_shields_util.h"
 #include "brave/components/brave_shields/browser/brave_shields_web_contents_observer.h"
 #include "brave/components/brave_shields/common/brave_shield_constants.h"
+#include "brave/components/brave_shields/common/features.h"
 #include "brave/grit/brave_generated_resources.h"
 #include "content/public/browser/browser_context.h"
+#include "content/public/browser/browser_task_traits.h"
 #include "content/public/browser/browser_thread.h"
 #include "content/public/browser/render_frame_host.h"
 #include "content/public/browser/storage_partition.h"
@@ -54,31 +64,6 @@ content::WebContents* GetWebContents(int render_process_id,
 
 }  // namespace
 
-void ShouldBlockAdOnTaskRunner(std::shared_ptr<BraveRequestInfo> ctx,
-                               base::Optional<std::string> canonical_name) {
-  bool did_match_exception = false;
-  std::string tab_host = ctx->tab_origin.host();
-  if (!g_brave_browser_process->ad_block_service()->ShouldStartRequest(
-          ctx->request_url, ctx->resource_type, tab_host, &did_match_exception,
-          &ctx->mock_data_url)) {
-    ctx->blocked_by = kAdBlocked;
-  } else if (!did_match_exception && canonical_name.has_value() &&
-             ctx->request_url.host() != *canonical_name &&
-             *canonical_name != "") {
-    GURL::Replacements replacements = GURL::Replacements();
-    replacements.SetHost(
-        canonical_name->c_str(),
-        url::Component(0, static_cast<int>(canonical_name->length())));
-    const GURL canonical_url = ctx->request_url.ReplaceComponents(replacements);
-
-    if (!g_brave_browser_process->ad_block_service()->ShouldStartRequest(
-            canonical_url, ctx->resource_type, tab_host, &did_match_exception,
-            &ctx->mock_data_url)) {
-      ctx->blocked_by = kAdBlocked;
-    }
-  }
-}
-
 void OnShouldBlockAdResult(const ResponseCallback& next_callback,
                            std::shared_ptr<BraveRequestInfo> ctx) {
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
@@ -90,55 +75,258 @@ void OnShouldBlockAdResult(const ResponseCallback& next_callback,
   next_callback.Run();
 }
 
-void ShouldBlockAdWithOptionalCname(
-    scoped_refptr<base::SequencedTaskRunner> task_runner,
-    const ResponseCallback& next_callback,
-    std::shared_ptr<BraveRequestInfo> ctx,
-    const base::Optional<std::string> cname) {
-  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
-  task_runner->PostTaskAndReply(
-      FROM_HERE, base::BindOnce(&ShouldBlockAdOnTaskRunner, ctx, cname),
-      base::BindOnce(&OnShouldBlockAdResult, next_callback, ctx));
+void OnAdBlockCheckDone(const ResponseCallback& next_callback,
+                        std::shared_ptr<BraveRequestInfo> ctx,
+                        bool decided) {
+  OnShouldBlockAdResult(next_callback, ctx);
 }
 
-class AdblockCnameResolveHostClient : public network::mojom::ResolveHostClient {
+// Returns true if |canonical_name| uncloaks |url| to a different host, which
+// then has to be matched as well.
+bool ShouldCheckCanonicalName(
+    const GURL& url,
+    const base::Optional<std::string>& canonical_name) {
+  return canonical_name.has_value() && !canonical_name->empty() &&
+         url.host() != *canonical_name;
+}
+
+// Coalesces the ad block checks that arrive while a batch is waiting for its
+// matching sequence, so a burst of subresources costs a single task hop
+// there and back instead of one per request. With parallel matching the next
+// batch can start on another sequence while the previous one is matched.
+class AdBlockRequestBatcher {
+ public:
+  // |decided| is true when the request was blocked or matched an exception,
+  // in which case no further check can change the outcome.
+  using CheckCallback = base::OnceCallback<void(bool decided)>;
+
+  struct PendingCheck {
+    PendingCheck(std::shared_ptr<BraveRequestInfo> ctx,
+                 const base::Optional<std::string>& canonical_name,
+                 bool check_request_url,
+                 CheckCallback callback)
+        : ctx(ctx),
+          canonical_name(canonical_name),
+          check_request_url(check_request_url),
+          callback(std::move(callback)),
+          queued_time(base::TimeTicks::Now()) {}
+    PendingCheck(PendingCheck&& other) = default;
+    PendingCheck& operator=(PendingCheck&& other) = default;
+    ~PendingCheck() = default;
+
+    std::shared_ptr<BraveRequestInfo> ctx;
+    base::Optional<std::string> canonical_name;
+    bool check_request_url;
+    CheckCallback callback;
+    bool decided = false;
+    base::TimeTicks queued_time;
+    // Time spent waiting for the matching sequence, set once matched.
+    base::TimeDelta queue_time;
+  };
+
+  static AdBlockRequestBatcher* GetInstance() {
+    static base::NoDestructor<AdBlockRequestBatcher> instance;
+    return instance.get();
+  }
+
+  AdBlockRequestBatcher() = default;
+
+  // Matches the request URL of |ctx| unless |check_request_url| is false,
+  // then its uncloaked |canonical_name| if the request URL was let through.
+  void AddCheck(scoped_refptr<base::SequencedTaskRunner> task_runner,
+                std::shared_ptr<BraveRequestInfo> ctx,
+                const base::Optional<std::string>& canonical_name,
+                bool check_request_url,
+                CheckCallback callback) {
+    DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+    {
+      base::AutoLock lock(lock_);
+      pending_.emplace_back(ctx, canonical_name, check_request_url,
+                            std::move(callback));
+      if (flush_scheduled_)
+        return;
+      flush_scheduled_ = true;
+    }
+    task_runner->PostTask(FROM_HERE,
+                          base::BindOnce(&AdBlockRequestBatcher::Flush,
+                                         base::Unretained(this)));
+  }
+
  private:
-  mojo::Receiver<network::mojom::ResolveHostClient> receiver_{this};
-  base::OnceCallback<void(base::Optional<std::string>)> cb_;
-  base::TimeTicks start_time_;
+  void Flush() {
+    std::vector<PendingCheck> batch;
+    {
+      base::AutoLock lock(lock_);
+      batch.swap(pending_);
+      flush_scheduled_ = false;
+    }
+
+    const base::TimeTicks now = base::TimeTicks::Now();
+    for (auto& check : batch) {
+      check.queue_time = now - check.queued_time;
+      UMA_HISTOGRAM_TIMES("Brave.Adblock.MatchingQueueTime", check.queue_time);
+    }
+
+    auto* ad_block_service = g_brave_browser_process->ad_block_service();
+    std::vector<brave_shields::AdBlockMatchRequest> requests;
+    std::vector<size_t> request_indices;
+    requests.reserve(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+      if (!batch[i].check_request_url)
+        continue;
+      const BraveRequestInfo* ctx = batch[i].ctx.get();
+      requests.emplace_back(ctx->request_url, ctx->resource_type,
+                            ctx->tab_origin.host());
+      request_indices.push_back(i);
+    }
+    std::vector<brave_shields::AdBlockMatchResult> results(batch.size());
+    if (!requests.empty()) {
+      std::vector<brave_shields::AdBlockMatchResult> request_results =
+          ad_block_service->ShouldStartRequests(requests);
+      for (size_t j = 0; j < request_indices.size(); ++j)
+        results[request_indices[j]] = request_results[j];
+    }
+
+    // Requests that were let through are checked once more against their
+    // uncloaked canonical name, again as a single batch.
+    std::vector<brave_shields::AdBlockMatchRequest> cname_requests;
+    std::vector<size_t> cname_indices;
+    for (size_t i = 0; i < batch.size(); ++i) {
+      BraveRequestInfo* ctx = batch[i].ctx.get();
+      const base::Optional<std::string>& canonical_name =
+          batch[i].canonical_name;
+      ApplyResult(results[i], &batch[i]);
+      if (batch[i].decided ||
+          !ShouldCheckCanonicalName(ctx->request_url, canonical_name)) {
+        continue;
+      }
+      GURL::Replacements replacements = GURL::Replacements();
+      replacements.SetHost(
+          canonical_name->c_str(),
+          url::Component(0, static_cast<int>(canonical_name->length())));
+      cname_requests.emplace_back(
+          ctx->request_url.ReplaceComponents(replacements),
+          ctx->resource_type, ctx->tab_origin.host());
+      cname_indices.push_back(i);
+    }
+    if (!cname_requests.empty()) {
+      std::vector<brave_shields::AdBlockMatchResult> cname_results =
+          ad_block_service->ShouldStartRequests(cname_requests);
+      for (size_t j = 0; j < cname_indices.size(); ++j)
+        ApplyResult(cname_results[j], &batch[cname_indices[j]]);
+    }
+
+    base::PostTask(FROM_HERE, {content::BrowserThread::UI},
+                   base::BindOnce(&AdBlockRequestBatcher::RunCallbacks,
+                                  std::move(batch)));
+  }
 
+  static void ApplyResult(const brave_shields::AdBlockMatchResult& result,
+                          PendingCheck* check) {
+    if (!result.mock_data_url.empty())
+      check->ctx->mock_data_url = result.mock_data_url;
+    if (!result.should_start)
+      check->ctx->blocked_by = kAdBlocked;
+    if (!result.should_start || result.did_match_exception)
+      check->decided = true;
+  }
+
+  static void RunCallbacks(std::vector<PendingCheck> batch) {
+    for (auto& check : batch) {
+      check.ctx->timing.adblock_queue_time += check.queue_time;
+      std::move(check.callback).Run(check.decided);
+    }
+  }
+
+  base::Lock lock_;
+  std::vector<PendingCheck> pending_;
+  bool flush_scheduled_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(AdBlockRequestBatcher);
+};
+
+// Matches a request URL while its CNAME is still being resolved. The request
+// continues as soon as the request URL is blocked or excepted, otherwise
+// once the canonical name is known and, if it differs, matched as well.
+class ParallelCnameCheck : public base::RefCounted<ParallelCnameCheck> {
  public:
-  AdblockCnameResolveHostClient(
-      const ResponseCallback& next_callback,
-      scoped_refptr<base::SequencedTaskRunner> task_runner,
-      std::shared_ptr<BraveRequestInfo> ctx) {
-    cb_ = base::BindOnce(&ShouldBlockAdWithOptionalCname, task_runner,
-                         std::move(next_callback), ctx);
-
-    auto* web_contents = GetWebContents(
-        ctx->render_process_id, ctx->render_frame_id, ctx->frame_tree_node_id);
-    if (!web_contents) {
-      start_time_ = base::TimeTicks::Now();
-      this->OnComplete(net::ERR_FAILED, net::ResolveErrorInfo(), base::nullopt);
+  ParallelCnameCheck(scoped_refptr<base::SequencedTaskRunner> task_runner,
+                     const ResponseCallback& next_callback,
+                     std::shared_ptr<BraveRequestInfo> ctx)
+      : task_runner_(task_runner), next_callback_(next_callback), ctx_(ctx) {}
+
+  void OnRequestUrlChecked(bool decided) {
+    DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+    request_url_checked_ = true;
+    decided_ = decided;
+    MaybeFinish();
+  }
+
+  void OnCnameResolved(base::Optional<std::string> canonical_name) {
+    DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+    cname_resolved_ = true;
+    canonical_name_ = canonical_name;
+    MaybeFinish();
+  }
+
+ private:
+  friend class base::RefCounted<ParallelCnameCheck>;
+  ~ParallelCnameCheck() = default;
+
+  void MaybeFinish() {
+    if (finished_ || !request_url_checked_)
+      return;
+    if (decided_) {
+      finished_ = true;
+      OnShouldBlockAdResult(next_callback_, ctx_);
       return;
     }
+    if (!cname_resolved_)
+      return;
 
-    content::BrowserContext* context = web_contents->GetBrowserContext();
+    finished_ = true;
+    if (!ShouldCheckCanonicalName(ctx_->request_url, canonical_name_)) {
+      OnShouldBlockAdResult(next_callback_, ctx_);
+      return;
+    }
+    AdBlockRequestBatcher::GetInstance()->AddCheck(
+        task_runner_, ctx_, canonical_name_, false,
+        base::BindOnce(&OnAdBlockCheckDone, next_callback_, ctx_));
+  }
 
-    const auto network_isolation_key = ctx->network_isolation_key;
+  scoped_refptr<base::SequencedTaskRunner> task_runner_;
+  ResponseCallback next_callback_;
+  std::shared_ptr<BraveRequestInfo> ctx_;
+  base::Optional<std::string> canonical_name_;
+  bool request_url_checked_ = false;
+  bool cname_resolved_ = false;
+  bool decided_ = false;
+  bool finished_ = false;
 
+  DISALLOW_COPY_AND_ASSIGN(ParallelCnameCheck);
+};
+
+class AdblockCnameResolveHostClient : public network::mojom::ResolveHostClient {
+ private:
+  mojo::Receiver<network::mojom::ResolveHostClient> receiver_{this};
+  base::OnceCallback<void(base::Optional<std::string>)> cb_;
+  base::TimeTicks start_time_;
+
+ public:
+  AdblockCnameResolveHostClient(
+      network::mojom::NetworkContext* network_context,
+      const GURL& url,
+      const net::NetworkIsolationKey& network_isolation_key,
+      base::OnceCallback<void(base::Optional<std::string>)> cb)
+      : cb_(std::move(cb)) {
     network::mojom::ResolveHostParametersPtr optional_parameters =
         network::mojom::ResolveHostParameters::New();
     optional_parameters->include_canonical_name = true;
 
-    network::mojom::NetworkContext* network_context =
-        content::BrowserContext::GetDefaultStoragePartition(context)
-            ->GetNetworkContext();
-
     start_time_ = base::TimeTicks::Now();
 
     network_context->ResolveHost(
-        net::HostPortPair::FromURL(ctx->request_url), network_isolation_key,
+        net::HostPortPair::FromURL(url), network_isolation_key,
         std::move(optional_parameters), receiver_.BindNewPipeAndPassRemote());
 
     receiver_.set_disconnect_handler(
@@ -175,6 +363,33 @@ class AdblockCnameResolveHostClient : public network::mojom::ResolveHostClient {
   }
 };
 
+void OnCnameResolved(
+    std::shared_ptr<BraveRequestInfo> ctx,
+    base::TimeTicks start_time,
+    AdBlockCnameCache* cname_cache,
+    const std::string& host,
+    base::OnceCallback<void(base::Optional<std::string>)> callback,
+    base::Optional<std::string> canonical_name) {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  TRACE_EVENT_NESTABLE_ASYNC_END0("net", "AdBlockCnameResolution",
+                                  TRACE_ID_LOCAL(ctx->request_identifier));
+  ctx->timing.cname_resolution_time += base::TimeTicks::Now() - start_time;
+  if (cname_cache && canonical_name.has_value())
+    cname_cache->Put(host, *canonical_name);
+  std::move(callback).Run(canonical_name);
+}
+
+void ShouldBlockAdWithOptionalCname(
+    scoped_refptr<base::SequencedTaskRunner> task_runner,
+    const ResponseCallback& next_callback,
+    std::shared_ptr<BraveRequestInfo> ctx,
+    base::Optional<std::string> canonical_name) {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  AdBlockRequestBatcher::GetInstance()->AddCheck(
+      task_runner, ctx, canonical_name, true,
+      base::BindOnce(&OnAdBlockCheckDone, next_callback, ctx));
+}
+
 void OnBeforeURLRequestAdBlockTP(const ResponseCallback& next_callback,
                                  std::shared_ptr<BraveRequestInfo> ctx) {
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
@@ -187,9 +402,58 @@ void OnBeforeURLRequestAdBlockTP(const ResponseCallback& next_callback,
   DCHECK_NE(ctx->request_identifier, 0UL);
 
   scoped_refptr<base::SequencedTaskRunner> task_runner =
-      g_brave_browser_process->ad_block_service()->GetTaskRunner();
+      g_brave_browser_process->ad_block_service()->GetMatchingTaskRunner();
+
+  auto* web_contents = GetWebContents(
+      ctx->render_process_id, ctx->render_frame_id, ctx->frame_tree_node_id);
+  if (!web_contents) {
+    // Counted as an immediately failed resolution, as before the CNAME cache,
+    // so that the histogram still covers every request that is checked.
+    UMA_HISTOGRAM_TIMES("Brave.ShieldsCNAMEBlocking.TotalResolutionTime",
+                        base::TimeDelta());
+    ShouldBlockAdWithOptionalCname(task_runner, next_callback, ctx,
+                                   base::nullopt);
+    return;
+  }
+  content::BrowserContext* context = web_contents->GetBrowserContext();
+
+  // Resolutions made in private windows are not remembered beyond them.
+  AdBlockCnameCache* cname_cache =
+      context->IsOffTheRecord() ? nullptr : AdBlockCnameCache::GetInstance();
+  const std::string host = ctx->request_url.host();
+  std::string canonical_name;
+  if (cname_cache && cname_cache->Get(host, &canonical_name)) {
+    ShouldBlockAdWithOptionalCname(task_runner, next_callback, ctx,
+                                   canonical_name);
+    return;
+  }
+
+  base::OnceCallback<void(base::Optional<std::string>)> resolved_callback;
+  if (base::FeatureList::IsEnabled(
+          brave_shields::features::kBraveAdblockCnameParallelCheck)) {
+    auto parallel_check =
+        base::MakeRefCounted<ParallelCnameCheck>(task_runner, next_callback,
+                                                 ctx);
+    AdBlockRequestBatcher::GetInstance()->AddCheck(
+        task_runner, ctx, base::nullopt, true,
+        base::BindOnce(&ParallelCnameCheck::OnRequestUrlChecked,
+                       parallel_check));
+    resolved_callback = base::BindOnce(&ParallelCnameCheck::OnCnameResolved,
+                                       parallel_check);
+  } else {
+    resolved_callback = base::BindOnce(&ShouldBlockAdWithOptionalCname,
+                                       task_runner, next_callback, ctx);
+  }
 
-  new AdblockCnameResolveHostClient(std::move(next_callback), task_runner, ctx);
+  network::mojom::NetworkContext* network_context =
+      content::BrowserContext::GetDefaultStoragePartition(context)
+          ->GetNetworkContext();
+  TRACE_EVENT_NESTABLE_ASYNC_BEGIN0("net", "AdBlockCnameResolution",
+                                    TRACE_ID_LOCAL(ctx->request_identifier));
+  new AdblockCnameResolveHostClient(
+      network_context, ctx->request_url, ctx->network_isolation_key,
+      base::BindOnce(&OnCnameResolved, ctx, base::TimeTicks::Now(),
+                     cname_cache, host, std::move(resolved_callback)));
 }
 
 int OnBeforeURLRequest_AdBlockTPPreWork(const ResponseCallback& next_callback,
@@ -13,7 +13,9 @@
 #include "base/strings/stringprintf.h"
 #include "base/task/post_task.h"
 #include "brave/browser/net/brave_request_handler.h"
+#include "brave/common/brave_features.h"
 #include "brave/components/brave_shields/browser/adblock_stub_response.h"
+#include "brave/components/brave_shields/browser/brave_shields_web_contents_observer.h"
 #include "content/public/browser/browser_context.h"
 #include "content/public/browser/browser_task_traits.h"
 #include "content/public/browser/browser_thread.h"
@@ -143,6 +145,23 @@ void BraveProxyingURLLoaderFactory::InProgressRequest::RestartInternal() {
       base::BindRepeating(&InProgressRequest::ContinueToBeforeSendHeaders,
                           weak_factory_.GetWeakPtr());
   redirect_url_ = GURL();
+
+  // Requests no handler can act on go on without a context, which later
+  // stages create. Only the first stage of a request is considered, as
+  // redirects carry state in |ctx_|.
+  if (!ctx_ &&
+      base::FeatureList::IsEnabled(features::kBraveRequestHandlerFastPath)) {
+    const bool skip_handlers =
+        factory_->request_handler_->CanSkipOnBeforeURLRequest(
+            request_, factory_->GetTabRequestPolicy(request_));
+    UMA_HISTOGRAM_BOOLEAN("Brave.ProxyingURLLoader.SkippedHandlers",
+                          skip_handlers);
+    if (skip_handlers) {
+      continuation.Run(net::OK);
+      return;
+    }
+  }
+
   ctx_ = brave::BraveRequestInfo::MakeCTX(request_, render_process_id_,
                                           frame_tree_node_id_, request_id_,
                                           browser_context_, ctx_);
@@ -338,8 +357,8 @@ void BraveProxyingURLLoaderFactory::InProgressRequest::
     return;
   }
 
-  DCHECK(ctx_);
-  if (ctx_->new_referrer.has_value()) {
+  // There is no |ctx_| yet if the handlers were skipped.
+  if (ctx_ && ctx_->new_referrer.has_value()) {
     request_.referrer = ctx_->new_referrer.value();
   }
 
@@ -347,7 +366,7 @@ void BraveProxyingURLLoaderFactory::InProgressRequest::
     proxied_client_receiver_.Resume();
 
   // TODO(iefremov): Shorten
-  if (ctx_->blocked_by != brave::kNotBlocked) {
+  if (ctx_ && ctx_->blocked_by != brave::kNotBlocked) {
     if (!ctx_->ShouldMockRequest()) {
       OnRequestError(
           network::URLLoaderCompletionStatus(net::ERR_BLOCKED_BY_CLIENT));
@@ -711,6 +730,21 @@ void BraveProxyingURLLoaderFactory::RemoveRequest(InProgressRequest* request) {
   MaybeRemoveProxy();
 }
 
+brave::TabRequestPolicy BraveProxyingURLLoaderFactory::GetTabRequestPolicy(
+    const network::ResourceRequest& request) {
+  auto* cache =
+      brave::TabRequestPolicyCache::FromFrameTreeNodeId(frame_tree_node_id_);
+  if (cache)
+    return cache->Get();
+  return brave::TabRequestPolicy::Create(
+      browser_context_,
+      brave_shields::BraveShieldsWebContentsObserver::
+          GetTabURLFromRenderFrameInfo(render_process_id_,
+                                       request.render_frame_id,
+                                       frame_tree_node_id_)
+              .GetOrigin());
+}
+
 void BraveProxyingURLLoaderFactory::MaybeRemoveProxy() {
   // Even if all URLLoaderFactory pipes connected to this object have been
   // closed it has to stay alive until all active requests have completed.
@@ -22,6 +22,7 @@
 #include "base/optional.h"
 #include "base/time/time.h"
 #include "brave/browser/net/resource_context_data.h"
+#include "brave/browser/net/tab_request_policy.h"
 #include "brave/browser/net/url_context.h"
 #include "mojo/public/cpp/bindings/binding.h"
 #include "mojo/public/cpp/bindings/pending_receiver.h"
@@ -215,6 +216,11 @@ class BraveProxyingURLLoaderFactory
 
   void MaybeRemoveProxy();
 
+  // Returns the policy of the tab |request| is made from, which the tab keeps
+  // until it navigates or shields settings change.
+  brave::TabRequestPolicy GetTabRequestPolicy(
+      const network::ResourceRequest& request);
+
   BraveRequestHandler* const request_handler_;
   content::BrowserContext* browser_context_;
   const int render_process_id_;
@@ -8,14 +8,18 @@
 #include <algorithm>
 #include <utility>
 
+#include "base/metrics/histogram_functions.h"
 #include "base/metrics/histogram_macros.h"
+#include "base/strings/strcat.h"
 #include "base/task/post_task.h"
+#include "base/trace_event/trace_event.h"
 #include "brave/browser/net/brave_ad_block_tp_network_delegate_helper.h"
 #include "brave/browser/net/brave_common_static_redirect_network_delegate_helper.h"
 #include "brave/browser/net/brave_httpse_network_delegate_helper.h"
 #include "brave/browser/net/brave_site_hacks_network_delegate_helper.h"
 #include "brave/browser/net/brave_stp_util.h"
 #include "brave/browser/net/global_privacy_control_network_delegate_helper.h"
+#include "brave/browser/net/request_timing_log.h"
 #include "brave/browser/translate/buildflags/buildflags.h"
 #include "brave/common/pref_names.h"
 #include "brave/components/brave_referrals/buildflags/buildflags.h"
@@ -30,6 +34,8 @@
 #include "content/public/common/url_constants.h"
 #include "extensions/common/constants.h"
 #include "net/base/net_errors.h"
+#include "services/network/public/cpp/resource_request.h"
+#include "url/origin.h"
 
 #if BUILDFLAG(ENABLE_BRAVE_REFERRALS)
 #include "brave/browser/net/brave_referrals_network_delegate_helper.h"
@@ -51,13 +57,49 @@
 #include "brave/browser/net/ipfs_redirect_network_delegate_helper.h"
 #endif
 
+namespace {
+
+const char* GetStageName(brave::BraveNetworkDelegateEventType event_type) {
+  switch (event_type) {
+    case brave::kOnBeforeRequest:
+      return "OnBeforeURLRequest";
+    case brave::kOnBeforeStartTransaction:
+      return "OnBeforeStartTransaction";
+    case brave::kOnHeadersReceived:
+      return "OnHeadersReceived";
+    default:
+      NOTREACHED();
+      return "Unknown";
+  }
+}
+
+void RecordStageTime(brave::BraveNetworkDelegateEventType event_type,
+                     base::TimeDelta elapsed) {
+  switch (event_type) {
+    case brave::kOnBeforeRequest:
+      UMA_HISTOGRAM_TIMES("Brave.OnBeforeURLRequest_Stage", elapsed);
+      break;
+    case brave::kOnBeforeStartTransaction:
+      UMA_HISTOGRAM_TIMES("Brave.OnBeforeStartTransaction_Stage", elapsed);
+      break;
+    case brave::kOnHeadersReceived:
+      UMA_HISTOGRAM_TIMES("Brave.OnHeadersReceived_Stage", elapsed);
+      break;
+    default:
+      NOTREACHED();
+  }
+}
+
+}  // namespace
+
 static bool IsInternalScheme(std::shared_ptr<brave::BraveRequestInfo> ctx) {
   DCHECK(ctx);
   return ctx->request_url.SchemeIs(extensions::kExtensionScheme) ||
          ctx->request_url.SchemeIs(content::kChromeUIScheme);
 }
 
-BraveRequestHandler::BraveRequestHandler() {
+BraveRequestHandler::BraveRequestHandler()
+    : record_timing_(brave::RequestTimingLog::IsEnabled()) {
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
   SetupCallbacks();
   // Initialize the preference change registrar.
@@ -66,54 +108,93 @@ BraveRequestHandler::BraveRequestHandler() {
 
 BraveRequestHandler::~BraveRequestHandler() = default;
 
+BraveRequestHandler::BeforeURLRequestHandler::BeforeURLRequestHandler(
+    const char* name,
+    const brave::OnBeforeURLRequestCallback& callback,
+    uint32_t reads,
+    uint32_t writes)
+    : name(name),
+      callback(callback),
+      reads(reads),
+      writes(writes) {}
+
+BraveRequestHandler::BeforeURLRequestHandler::BeforeURLRequestHandler(
+    const BeforeURLRequestHandler& other) = default;
+
+BraveRequestHandler::BeforeURLRequestHandler::~BeforeURLRequestHandler() =
+    default;
+
+void BraveRequestHandler::AddBeforeURLRequestHandler(
+    const char* name,
+    const brave::OnBeforeURLRequestCallback& callback,
+    uint32_t reads,
+    uint32_t writes) {
+  BeforeURLRequestHandler handler(name, callback, reads, writes);
+  for (size_t i = 0; i < before_url_request_handlers_.size(); ++i) {
+    const BeforeURLRequestHandler& earlier = before_url_request_handlers_[i];
+    if ((earlier.writes & (reads | writes)) || (earlier.reads & writes))
+      handler.dependencies.push_back(i);
+  }
+  before_url_request_handlers_.push_back(handler);
+}
+
 void BraveRequestHandler::SetupCallbacks() {
-  brave::OnBeforeURLRequestCallback callback =
-      base::Bind(brave::OnBeforeURLRequest_SiteHacksWork);
-  before_url_request_callbacks_.push_back(callback);
+  AddBeforeURLRequestHandler(
+      "SiteHacks", base::Bind(brave::OnBeforeURLRequest_SiteHacksWork),
+      brave::kRequestFields,
+      brave::kNewURLFields | brave::kNewReferrerFields |
+          brave::kHeaderChangesFields);
 
-  callback = base::Bind(brave::OnBeforeURLRequest_AdBlockTPPreWork);
-  before_url_request_callbacks_.push_back(callback);
+  AddBeforeURLRequestHandler(
+      "AdBlockTP", base::Bind(brave::OnBeforeURLRequest_AdBlockTPPreWork),
+      brave::kRequestFields, brave::kBlockedByFields);
 
-  callback = base::Bind(brave::OnBeforeURLRequest_HttpsePreFileWork);
-  before_url_request_callbacks_.push_back(callback);
+  AddBeforeURLRequestHandler(
+      "HTTPSE", base::Bind(brave::OnBeforeURLRequest_HttpsePreFileWork),
+      brave::kRequestFields | brave::kNewURLFields, brave::kNewURLFields);
 
-  callback = base::Bind(brave::OnBeforeURLRequest_CommonStaticRedirectWork);
-  before_url_request_callbacks_.push_back(callback);
+  AddBeforeURLRequestHandler(
+      "CommonStaticRedirect",
+      base::Bind(brave::OnBeforeURLRequest_CommonStaticRedirectWork),
+      brave::kRequestFields, brave::kNewURLFields);
 
 #if BUILDFLAG(BRAVE_REWARDS_ENABLED)
-  callback = base::Bind(brave_rewards::OnBeforeURLRequest);
-  before_url_request_callbacks_.push_back(callback);
+  AddBeforeURLRequestHandler(
+      "Rewards", base::Bind(brave_rewards::OnBeforeURLRequest),
+      brave::kRequestFields | brave::kUploadDataFields, brave::kNoFields);
 #endif
 
 #if BUILDFLAG(ENABLE_BRAVE_TRANSLATE_GO)
-  callback =
-      base::BindRepeating(brave::OnBeforeURLRequest_TranslateRedirectWork);
-  before_url_request_callbacks_.push_back(callback);
+  AddBeforeURLRequestHandler(
+      "TranslateRedirect",
+      base::BindRepeating(brave::OnBeforeURLRequest_TranslateRedirectWork),
+      brave::kRequestFields, brave::kNewURLFields);
 #endif
 
 #if BUILDFLAG(IPFS_ENABLED)
-  callback = base::BindRepeating(ipfs::OnBeforeURLRequest_IPFSRedirectWork);
-  before_url_request_callbacks_.push_back(callback);
+  AddBeforeURLRequestHandler(
+      "IPFSRedirect",
+      base::BindRepeating(ipfs::OnBeforeURLRequest_IPFSRedirectWork),
+      brave::kRequestFields, brave::kNewURLFields);
 #endif
 
-  brave::OnBeforeStartTransactionCallback start_transaction_callback =
-      base::Bind(brave::OnBeforeStartTransaction_SiteHacksWork);
-  before_start_transaction_callbacks_.push_back(start_transaction_callback);
+  before_start_transaction_callbacks_.push_back(
+      {"SiteHacks",
+       base::Bind(brave::OnBeforeStartTransaction_SiteHacksWork)});
 
-  start_transaction_callback =
-      base::Bind(brave::OnBeforeStartTransaction_GlobalPrivacyControlWork);
-  before_start_transaction_callbacks_.push_back(start_transaction_callback);
+  before_start_transaction_callbacks_.push_back(
+      {"GlobalPrivacyControl",
+       base::Bind(brave::OnBeforeStartTransaction_GlobalPrivacyControlWork)});
 
 #if BUILDFLAG(ENABLE_BRAVE_REFERRALS)
-  start_transaction_callback =
-      base::Bind(brave::OnBeforeStartTransaction_ReferralsWork);
-  before_start_transaction_callbacks_.push_back(start_transaction_callback);
+  before_start_transaction_callbacks_.push_back(
+      {"Referrals", base::Bind(brave::OnBeforeStartTransaction_ReferralsWork)});
 #endif
 
 #if BUILDFLAG(ENABLE_BRAVE_WEBTORRENT)
-  brave::OnHeadersReceivedCallback headers_received_callback =
-      base::Bind(webtorrent::OnHeadersReceived_TorrentRedirectWork);
-  headers_received_callbacks_.push_back(headers_received_callback);
+  headers_received_callbacks_.push_back(
+      {"TorrentRedirect",
+       base::Bind(webtorrent::OnHeadersReceived_TorrentRedirectWork)});
 #endif
 }
 
@@ -140,24 +221,63 @@ void BraveRequestHandler::OnReferralHeadersChanged() {
   }
 }
 
-bool BraveRequestHandler::IsRequestIdentifierValid(
-    uint64_t request_identifier) {
-  return base::Contains(callbacks_, request_identifier);
+bool BraveRequestHandler::CanSkipOnBeforeURLRequest(
+    const network::ResourceRequest& request,
+    const brave::TabRequestPolicy& policy) const {
+  // Ad block, HTTPSE and the referrer policy only act with shields up.
+  if (policy.shields_up || policy.tab_origin.is_empty()) {
+    return false;
+  }
+  // IPFS only acts on its own schemes, and frames can change the tab itself.
+  const GURL& url = request.url;
+  const auto resource_type =
+      static_cast<blink::mojom::ResourceType>(request.resource_type);
+  if (!url.SchemeIsHTTPOrHTTPS() ||
+      resource_type == blink::mojom::ResourceType::kMainFrame ||
+      resource_type == blink::mojom::ResourceType::kSubFrame ||
+      request.trusted_params) {
+    return false;
+  }
+  // The query string filter leaves same-site requests alone.
+  const url::Origin tab_origin = url::Origin::Create(policy.tab_origin);
+  if (!request.request_initiator ||
+      !request.request_initiator->IsSameOriginWith(tab_origin) ||
+      !url::Origin::Create(url).IsSameOriginWith(tab_origin)) {
+    return false;
+  }
+  // Rewards only looks at request bodies.
+  if (request.request_body) {
+    return false;
+  }
+  GURL new_url;
+  if (brave::OnBeforeURLRequest_CommonStaticRedirectWorkForGURL(
+          url, &new_url) != net::OK ||
+      !new_url.is_empty()) {
+    return false;
+  }
+#if BUILDFLAG(ENABLE_BRAVE_TRANSLATE_GO)
+  if (brave::IsTranslateRedirectCandidate(url)) {
+    return false;
+  }
+#endif
+  return true;
 }
 
 int BraveRequestHandler::OnBeforeURLRequest(
     std::shared_ptr<brave::BraveRequestInfo> ctx,
     net::CompletionOnceCallback callback,
     GURL* new_url) {
-  if (before_url_request_callbacks_.empty() || IsInternalScheme(ctx)) {
+  if (before_url_request_handlers_.empty() || IsInternalScheme(ctx)) {
     return net::OK;
   }
   SCOPED_UMA_HISTOGRAM_TIMER("Brave.OnBeforeURLRequest_Handler");
   ctx->new_url = new_url;
   ctx->event_type = brave::kOnBeforeRequest;
-  callbacks_[ctx->request_identifier] = std::move(callback);
-  RunNextCallback(ctx);
-  return net::ERR_IO_PENDING;
+  ctx->handler_progress_.assign(before_url_request_handlers_.size(),
+                                brave::BraveRequestInfo::HandlerProgress());
+  StartStage(ctx.get(), std::move(callback));
+  RunBeforeURLRequestHandlers(ctx);
+  return EndStageHook(ctx.get());
 }
 
 int BraveRequestHandler::OnBeforeStartTransaction(
@@ -170,9 +290,9 @@ int BraveRequestHandler::OnBeforeStartTransaction(
   ctx->event_type = brave::kOnBeforeStartTransaction;
   ctx->headers = headers;
   ctx->referral_headers_list = referral_headers_list_.get();
-  callbacks_[ctx->request_identifier] = std::move(callback);
-  RunNextCallback(ctx);
-  return net::ERR_IO_PENDING;
+  StartStage(ctx.get(), std::move(callback));
+  RunNextCallback(ctx, ctx->stage_callback_.generation());
+  return EndStageHook(ctx.get());
 }
 
 int BraveRequestHandler::OnHeadersReceived(
@@ -193,116 +313,282 @@ int BraveRequestHandler::OnHeadersReceived(
     return net::OK;
   }
 
-  callbacks_[ctx->request_identifier] = std::move(callback);
   ctx->event_type = brave::kOnHeadersReceived;
   ctx->original_response_headers = original_response_headers;
   ctx->override_response_headers = override_response_headers;
   ctx->allowed_unsafe_redirect_url = allowed_unsafe_redirect_url;
+  StartStage(ctx.get(), std::move(callback));
 
-  RunNextCallback(ctx);
-  return net::ERR_IO_PENDING;
+  RunNextCallback(ctx, ctx->stage_callback_.generation());
+  return EndStageHook(ctx.get());
 }
 
 void BraveRequestHandler::OnURLRequestDestroyed(
     std::shared_ptr<brave::BraveRequestInfo> ctx) {
-  if (base::Contains(callbacks_, ctx->request_identifier)) {
-    callbacks_.erase(ctx->request_identifier);
+  if (record_timing_ && !ctx->timing.stages.empty()) {
+    brave::RequestTimingLog::GetInstance()->Add(ctx->request_url,
+                                                ctx->timing);
   }
+  ctx->stage_callback_.Reset();
 }
 
-void BraveRequestHandler::RunCallbackForRequestIdentifier(
-    uint64_t request_identifier,
-    int rv) {
-  std::map<uint64_t, net::CompletionOnceCallback>::iterator it =
-      callbacks_.find(request_identifier);
-  // We intentionally do the async call to maintain the proper flow
-  // of URLLoader callbacks.
+void BraveRequestHandler::StartStage(brave::BraveRequestInfo* ctx,
+                                     net::CompletionOnceCallback callback) {
+  ctx->stage_callback_.Arm(std::move(callback));
+  ctx->in_stage_hook_ = true;
+  ctx->stage_result_ = net::ERR_IO_PENDING;
+  ctx->stage_start_time_ = base::TimeTicks::Now();
+  TRACE_EVENT_NESTABLE_ASYNC_BEGIN0(
+      "net", GetStageName(ctx->event_type),
+      TRACE_ID_LOCAL(ctx->request_identifier));
+}
+
+int BraveRequestHandler::EndStageHook(brave::BraveRequestInfo* ctx) {
+  ctx->in_stage_hook_ = false;
+  return ctx->stage_result_;
+}
+
+void BraveRequestHandler::StartHandler(brave::BraveRequestInfo* ctx,
+                                       const char* handler) {
+  TRACE_EVENT_NESTABLE_ASYNC_BEGIN0("net", handler,
+                                    TRACE_ID_LOCAL(ctx->request_identifier));
+}
+
+void BraveRequestHandler::RecordHandlerTime(brave::BraveRequestInfo* ctx,
+                                            const char* handler,
+                                            base::TimeTicks start_time) {
+  TRACE_EVENT_NESTABLE_ASYNC_END0("net", handler,
+                                  TRACE_ID_LOCAL(ctx->request_identifier));
+  const char* stage = GetStageName(ctx->event_type);
+  const base::TimeDelta elapsed = base::TimeTicks::Now() - start_time;
+  base::UmaHistogramTimes(
+      base::StrCat({"Brave.", stage, "_Handler.", handler}), elapsed);
+  if (record_timing_)
+    ctx->timing.handlers[base::StrCat({stage, ".", handler})] += elapsed;
+}
+
+void BraveRequestHandler::CompleteStage(brave::BraveRequestInfo* ctx,
+                                        int rv) {
+  if (!ctx->stage_callback_.is_pending()) {
+    return;
+  }
+  const char* stage = GetStageName(ctx->event_type);
+  TRACE_EVENT_NESTABLE_ASYNC_END1("net", stage,
+                                  TRACE_ID_LOCAL(ctx->request_identifier),
+                                  "rv", rv);
+  const base::TimeDelta elapsed =
+      base::TimeTicks::Now() - ctx->stage_start_time_;
+  RecordStageTime(ctx->event_type, elapsed);
+  if (record_timing_)
+    ctx->timing.stages[stage] += elapsed;
+
+  net::CompletionOnceCallback callback = ctx->stage_callback_.Take();
+  if (!ctx->in_stage_hook_) {
+    // Handlers that finish later report back on the UI thread, where the
+    // proxies expect the result.
+    std::move(callback).Run(rv);
+    return;
+  }
+  // The hook has not returned yet. The proxies handle these results when the
+  // hook returns them, rather than being called back in the middle of it.
+  if (rv == net::OK || rv == net::ERR_BLOCKED_BY_CLIENT) {
+    ctx->stage_result_ = rv;
+    return;
+  }
   base::PostTask(FROM_HERE, {content::BrowserThread::UI},
-                 base::BindOnce(std::move(it->second), rv));
+                 base::BindOnce(std::move(callback), rv));
 }
 
 // TODO(iefremov): Merge all callback containers into one and run only one loop
 // instead of many (issues/5574).
 void BraveRequestHandler::RunNextCallback(
-    std::shared_ptr<brave::BraveRequestInfo> ctx) {
+    std::shared_ptr<brave::BraveRequestInfo> ctx,
+    uint32_t generation) {
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
 
-  if (!base::Contains(callbacks_, ctx->request_identifier)) {
+  if (!ctx->stage_callback_.IsPending(generation)) {
     return;
   }
 
+  // Resuming after a handler that returned PENDING.
+  if (!ctx->handler_start_time_.is_null()) {
+    DCHECK_GT(ctx->next_url_request_index, 0u);
+    const size_t index = ctx->next_url_request_index - 1;
+    const char* handler =
+        ctx->event_type == brave::kOnBeforeStartTransaction
+            ? before_start_transaction_callbacks_[index].name
+            : headers_received_callbacks_[index].name;
+    RecordHandlerTime(ctx.get(), handler, ctx->handler_start_time_);
+    ctx->handler_start_time_ = base::TimeTicks();
+  }
+
   // Continue processing callbacks until we hit one that returns PENDING
   int rv = net::OK;
 
-  if (ctx->event_type == brave::kOnBeforeRequest) {
-    while (before_url_request_callbacks_.size() !=
-           ctx->next_url_request_index) {
-      brave::OnBeforeURLRequestCallback callback =
-          before_url_request_callbacks_[ctx->next_url_request_index++];
-      brave::ResponseCallback next_callback =
-          base::Bind(&BraveRequestHandler::RunNextCallback,
-                     weak_factory_.GetWeakPtr(), ctx);
-      rv = callback.Run(next_callback, ctx);
-      if (rv == net::ERR_IO_PENDING) {
-        return;
-      }
-      if (rv != net::OK) {
-        break;
-      }
-    }
-  } else if (ctx->event_type == brave::kOnBeforeStartTransaction) {
+  if (ctx->event_type == brave::kOnBeforeStartTransaction) {
     while (before_start_transaction_callbacks_.size() !=
            ctx->next_url_request_index) {
-      brave::OnBeforeStartTransactionCallback callback =
+      const auto& handler =
           before_start_transaction_callbacks_[ctx->next_url_request_index++];
       brave::ResponseCallback next_callback =
           base::Bind(&BraveRequestHandler::RunNextCallback,
-                     weak_factory_.GetWeakPtr(), ctx);
-      rv = callback.Run(ctx->headers, next_callback, ctx);
+                     weak_factory_.GetWeakPtr(), ctx, generation);
+      ctx->handler_start_time_ = base::TimeTicks::Now();
+      StartHandler(ctx.get(), handler.name);
+      rv = handler.callback.Run(ctx->headers, next_callback, ctx);
       if (rv == net::ERR_IO_PENDING) {
         return;
       }
+      RecordHandlerTime(ctx.get(), handler.name, ctx->handler_start_time_);
+      ctx->handler_start_time_ = base::TimeTicks();
       if (rv != net::OK) {
         break;
       }
     }
   } else if (ctx->event_type == brave::kOnHeadersReceived) {
     while (headers_received_callbacks_.size() != ctx->next_url_request_index) {
-      brave::OnHeadersReceivedCallback callback =
+      const auto& handler =
           headers_received_callbacks_[ctx->next_url_request_index++];
       brave::ResponseCallback next_callback =
           base::Bind(&BraveRequestHandler::RunNextCallback,
-                     weak_factory_.GetWeakPtr(), ctx);
-      rv = callback.Run(ctx->original_response_headers,
-                        ctx->override_response_headers,
-                        ctx->allowed_unsafe_redirect_url, next_callback, ctx);
+                     weak_factory_.GetWeakPtr(), ctx, generation);
+      ctx->handler_start_time_ = base::TimeTicks::Now();
+      StartHandler(ctx.get(), handler.name);
+      rv = handler.callback.Run(ctx->original_response_headers,
+                                ctx->override_response_headers,
+                                ctx->allowed_unsafe_redirect_url,
+                                next_callback, ctx);
       if (rv == net::ERR_IO_PENDING) {
         return;
       }
+      RecordHandlerTime(ctx.get(), handler.name, ctx->handler_start_time_);
+      ctx->handler_start_time_ = base::TimeTicks();
       if (rv != net::OK) {
         break;
       }
     }
   }
 
-  if (rv != net::OK) {
-    RunCallbackForRequestIdentifier(ctx->request_identifier, rv);
+  CompleteStage(ctx.get(), rv);
+}
+
+void BraveRequestHandler::RunBeforeURLRequestHandlers(
+    std::shared_ptr<brave::BraveRequestInfo> ctx) {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+
+  if (!ctx->stage_callback_.is_pending()) {
     return;
   }
 
-  if (ctx->event_type == brave::kOnBeforeRequest) {
-    if (!ctx->new_url_spec.empty() &&
-        (ctx->new_url_spec != ctx->request_url.spec()) &&
-        IsRequestIdentifierValid(ctx->request_identifier)) {
-      *ctx->new_url = GURL(ctx->new_url_spec);
-    }
-    if (ctx->blocked_by == brave::kAdBlocked) {
-      if (!ctx->ShouldMockRequest()) {
-        RunCallbackForRequestIdentifier(ctx->request_identifier,
-                                        net::ERR_BLOCKED_BY_CLIENT);
-        return;
+  std::vector<brave::BraveRequestInfo::HandlerProgress>& progress =
+      ctx->handler_progress_;
+  DCHECK_EQ(progress.size(), before_url_request_handlers_.size());
+  // Handlers may call their next callback before returning, which ends up
+  // here again: the loop below picks up what they unblocked instead.
+  if (ctx->running_handlers_) {
+    return;
+  }
+  ctx->running_handlers_ = true;
+
+  bool started = true;
+  while (started) {
+    started = false;
+    for (size_t i = 0; i < before_url_request_handlers_.size(); ++i) {
+      // Once a handler fails, the ones registered after it are not started.
+      if (progress[i].done && progress[i].rv != net::OK) {
+        break;
+      }
+      if (!progress[i].start_time.is_null()) {
+        continue;
+      }
+      bool ready = true;
+      for (size_t dependency : before_url_request_handlers_[i].dependencies) {
+        if (!progress[dependency].done) {
+          ready = false;
+          break;
+        }
       }
+      if (!ready) {
+        continue;
+      }
+
+      started = true;
+      progress[i].start_time = base::TimeTicks::Now();
+      StartHandler(ctx.get(), before_url_request_handlers_[i].name);
+      brave::ResponseCallback next_callback =
+          base::Bind(&BraveRequestHandler::OnBeforeURLRequestHandlerDone,
+                     weak_factory_.GetWeakPtr(), ctx,
+                     ctx->stage_callback_.generation(), i);
+      ctx->running_handler_reads_ = before_url_request_handlers_[i].reads;
+      int rv =
+          before_url_request_handlers_[i].callback.Run(next_callback, ctx);
+      ctx->running_handler_reads_.reset();
+      if (rv != net::ERR_IO_PENDING) {
+        SetBeforeURLRequestHandlerDone(ctx.get(), i, rv);
+      }
+    }
+  }
+  ctx->running_handlers_ = false;
+
+  // The request completes once every started handler is done. The first
+  // failure in registration order decides its result.
+  int rv = net::OK;
+  for (const auto& handler_progress : progress) {
+    if (handler_progress.start_time.is_null()) {
+      continue;
+    }
+    if (!handler_progress.done) {
+      return;
+    }
+    if (rv == net::OK) {
+      rv = handler_progress.rv;
+    }
+  }
+  CompleteBeforeURLRequest(ctx, rv);
+}
+
+void BraveRequestHandler::OnBeforeURLRequestHandlerDone(
+    std::shared_ptr<brave::BraveRequestInfo> ctx,
+    uint32_t generation,
+    size_t index) {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  if (!ctx->stage_callback_.IsPending(generation)) {
+    return;
+  }
+  SetBeforeURLRequestHandlerDone(ctx.get(), index, net::OK);
+  RunBeforeURLRequestHandlers(ctx);
+}
+
+void BraveRequestHandler::SetBeforeURLRequestHandlerDone(
+    brave::BraveRequestInfo* ctx,
+    size_t index,
+    int rv) {
+  brave::BraveRequestInfo::HandlerProgress& progress =
+      ctx->handler_progress_[index];
+  DCHECK(!progress.done);
+  progress.done = true;
+  progress.rv = rv;
+  RecordHandlerTime(ctx, before_url_request_handlers_[index].name,
+                    progress.start_time);
+}
+
+void BraveRequestHandler::CompleteBeforeURLRequest(
+    std::shared_ptr<brave::BraveRequestInfo> ctx,
+    int rv) {
+  if (rv != net::OK) {
+    CompleteStage(ctx.get(), rv);
+    return;
+  }
+
+  if (!ctx->new_url_spec.empty() &&
+      (ctx->new_url_spec != ctx->request_url.spec())) {
+    *ctx->new_url = GURL(ctx->new_url_spec);
+  }
+  if (ctx->blocked_by == brave::kAdBlocked) {
+    if (!ctx->ShouldMockRequest()) {
+      CompleteStage(ctx.get(), net::ERR_BLOCKED_BY_CLIENT);
+      return;
     }
   }
-  RunCallbackForRequestIdentifier(ctx->request_identifier, rv);
+  CompleteStage(ctx.get(), rv);
 }
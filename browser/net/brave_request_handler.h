@@ -6,17 +6,21 @@
 #ifndef BRAVE_BROWSER_NET_BRAVE_REQUEST_HANDLER_H_
 #define BRAVE_BROWSER_NET_BRAVE_REQUEST_HANDLER_H_
 
-#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "brave/browser/net/tab_request_policy.h"
 #include "brave/browser/net/url_context.h"
 #include "content/public/browser/browser_thread.h"
 #include "net/base/completion_once_callback.h"
 
 class PrefChangeRegistrar;
 
+namespace network {
+struct ResourceRequest;
+}
+
 // Contains different network stack hooks (similar to capabilities of WebRequest
 // API).
 class BraveRequestHandler {
@@ -26,7 +30,13 @@ class BraveRequestHandler {
   BraveRequestHandler();
   ~BraveRequestHandler();
 
-  bool IsRequestIdentifierValid(uint64_t request_identifier);
+  // Returns true if no OnBeforeURLRequest handler can act on |request|, made
+  // from a tab with |policy|: shields are down and |request| is a first-party
+  // subresource that no redirect applies to. Such requests can skip the
+  // handlers, and the context and task hops they need, altogether. Only
+  // consulted with features::kBraveRequestHandlerFastPath enabled.
+  bool CanSkipOnBeforeURLRequest(const network::ResourceRequest& request,
+                                 const brave::TabRequestPolicy& policy) const;
 
   int OnBeforeURLRequest(std::shared_ptr<brave::BraveRequestInfo> ctx,
                          net::CompletionOnceCallback callback,
@@ -43,21 +53,90 @@ class BraveRequestHandler {
       GURL* allowed_unsafe_redirect_url);
 
   void OnURLRequestDestroyed(std::shared_ptr<brave::BraveRequestInfo> ctx);
-  void RunCallbackForRequestIdentifier(uint64_t request_identifier, int rv);
 
  private:
+  // An OnBeforeURLRequest handler with the BraveRequestInfo fields it reads
+  // and writes (see brave::RequestInfoFields).
+  struct BeforeURLRequestHandler {
+    BeforeURLRequestHandler(const char* name,
+                            const brave::OnBeforeURLRequestCallback& callback,
+                            uint32_t reads,
+                            uint32_t writes);
+    BeforeURLRequestHandler(const BeforeURLRequestHandler& other);
+    ~BeforeURLRequestHandler();
+
+    const char* name;
+    brave::OnBeforeURLRequestCallback callback;
+    uint32_t reads;
+    uint32_t writes;
+    // Earlier handlers that have to be done before this one starts.
+    std::vector<size_t> dependencies;
+  };
+
+  // Registers a handler that depends on every earlier one that writes what it
+  // reads or writes, or that reads what it writes. Handlers with no such
+  // dependency between them run concurrently, while handlers writing the same
+  // fields keep their registration order, so the merged result of a request
+  // does not depend on which handler finishes first.
+  void AddBeforeURLRequestHandler(
+      const char* name,
+      const brave::OnBeforeURLRequestCallback& callback,
+      uint32_t reads,
+      uint32_t writes);
+  // A handler of a stage whose handlers run one after another. |name| is what
+  // its timings are reported under.
+  template <typename Callback>
+  struct SequentialHandler {
+    const char* name;
+    Callback callback;
+  };
+
   void SetupCallbacks();
   void InitPrefChangeRegistrar();
   void OnReferralHeadersChanged();
   void OnPreferenceChanged(const std::string& pref_name);
   void UpdateAdBlockFromPref(const std::string& pref_name);
 
-  void RunNextCallback(std::shared_ptr<brave::BraveRequestInfo> ctx);
-
-  std::vector<brave::OnBeforeURLRequestCallback> before_url_request_callbacks_;
-  std::vector<brave::OnBeforeStartTransactionCallback>
+  // Stage and handler timings are always reported as trace events and
+  // histograms. With --dump-slow-requests they are also kept in |ctx| for
+  // brave::RequestTimingLog.
+  void StartStage(brave::BraveRequestInfo* ctx,
+                  net::CompletionOnceCallback callback);
+  // Returns what the hook of the current stage returns: the stage's result if
+  // it is already known, ERR_IO_PENDING otherwise.
+  int EndStageHook(brave::BraveRequestInfo* ctx);
+  void StartHandler(brave::BraveRequestInfo* ctx, const char* handler);
+  void RecordHandlerTime(brave::BraveRequestInfo* ctx,
+                         const char* handler,
+                         base::TimeTicks start_time);
+  // Reports the time of the current stage and delivers its result.
+  void CompleteStage(brave::BraveRequestInfo* ctx, int rv);
+
+  // Handlers report back with the generation of the stage they were started
+  // in, see brave::StageCallbackSlot.
+  void RunNextCallback(std::shared_ptr<brave::BraveRequestInfo> ctx,
+                       uint32_t generation);
+  // Starts every OnBeforeURLRequest handler whose dependencies are done, and
+  // completes the request once no handler is left to run.
+  void RunBeforeURLRequestHandlers(
+      std::shared_ptr<brave::BraveRequestInfo> ctx);
+  void OnBeforeURLRequestHandlerDone(
+      std::shared_ptr<brave::BraveRequestInfo> ctx,
+      uint32_t generation,
+      size_t index);
+  void SetBeforeURLRequestHandlerDone(brave::BraveRequestInfo* ctx,
+                                      size_t index,
+                                      int rv);
+  void CompleteBeforeURLRequest(std::shared_ptr<brave::BraveRequestInfo> ctx,
+                                int rv);
+
+  // Whether request timings are recorded for brave::RequestTimingLog.
+  const bool record_timing_;
+  std::vector<BeforeURLRequestHandler> before_url_request_handlers_;
+  std::vector<SequentialHandler<brave::OnBeforeStartTransactionCallback>>
       before_start_transaction_callbacks_;
-  std::vector<brave::OnHeadersReceivedCallback> headers_received_callbacks_;
+  std::vector<SequentialHandler<brave::OnHeadersReceivedCallback>>
+      headers_received_callbacks_;
 
   // TODO(iefremov): actually, we don't have to keep the list here, since
   // it is global for the whole browser and could live a singletonce in the
@@ -65,7 +144,6 @@ class BraveRequestHandler {
   // PrefChangeRegistrar and corresponding |base::Unretained| usages, that are
   // illegal.
   std::unique_ptr<base::ListValue> referral_headers_list_;
-  std::map<uint64_t, net::CompletionOnceCallback> callbacks_;
   std::unique_ptr<PrefChangeRegistrar, content::BrowserThread::DeleteOnUIThread>
       pref_change_registrar_;
 
@@ -0,0 +1,186 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <memory>
+#include <string>
+
+#include "base/strings/stringprintf.h"
+#include "base/test/metrics/histogram_tester.h"
+#include "base/test/scoped_feature_list.h"
+#include "brave/common/brave_features.h"
+#include "brave/components/brave_shields/browser/brave_shields_util.h"
+#include "chrome/browser/content_settings/host_content_settings_map_factory.h"
+#include "chrome/browser/ui/browser.h"
+#include "chrome/test/base/in_process_browser_test.h"
+#include "chrome/test/base/ui_test_utils.h"
+#include "content/public/test/browser_test.h"
+#include "content/public/test/browser_test_utils.h"
+#include "net/dns/mock_host_resolver.h"
+#include "net/test/embedded_test_server/embedded_test_server.h"
+#include "net/test/embedded_test_server/http_request.h"
+#include "net/test/embedded_test_server/http_response.h"
+
+namespace {
+
+const char kSkippedHandlersHistogram[] =
+    "Brave.ProxyingURLLoader.SkippedHandlers";
+const int kSubresourceCount = 20;
+
+// A 1x1 transparent GIF.
+const char kPixel[] =
+    "GIF89a\x01\x00\x01\x00\x80\x00\x00\x00\x00\x00\x00\x00\x00!\xf9\x04\x01"
+    "\x00\x00\x00\x00,\x00\x00\x00\x00\x01\x00\x01\x00\x00\x02\x02D\x01\x00;";
+
+// Serves /images.html?<host>, a page with |kSubresourceCount| images from
+// <host>, and the uncacheable images themselves.
+std::unique_ptr<net::test_server::HttpResponse> HandleRequest(
+    const net::test_server::HttpRequest& request) {
+  auto response = std::make_unique<net::test_server::BasicHttpResponse>();
+  const GURL url = request.GetURL();
+  if (url.path() == "/images.html") {
+    std::string html = "<html><body>";
+    for (int i = 0; i < kSubresourceCount; ++i) {
+      html += base::StringPrintf("<img src=\"%s/pixel.gif?%d\">",
+                                 url.query().c_str(), i);
+    }
+    html += "</body></html>";
+    response->set_content_type("text/html");
+    response->set_content(html);
+    return response;
+  }
+  if (url.path() == "/pixel.gif") {
+    response->set_content_type("image/gif");
+    response->set_content(std::string(kPixel, sizeof(kPixel) - 1));
+    response->AddCustomHeader("Cache-Control", "no-store");
+    response->AddCustomHeader("Access-Control-Allow-Origin", "*");
+    return response;
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+// Runs with the request handler fast path enabled or disabled.
+class BraveRequestHandlerFastPathBrowserTest
+    : public InProcessBrowserTest,
+      public testing::WithParamInterface<bool> {
+ public:
+  BraveRequestHandlerFastPathBrowserTest() {
+    if (IsFastPathEnabled()) {
+      feature_list_.InitAndEnableFeature(
+          features::kBraveRequestHandlerFastPath);
+    } else {
+      feature_list_.InitAndDisableFeature(
+          features::kBraveRequestHandlerFastPath);
+    }
+  }
+
+  void SetUpOnMainThread() override {
+    InProcessBrowserTest::SetUpOnMainThread();
+    host_resolver()->AddRule("*", "127.0.0.1");
+    embedded_test_server()->RegisterRequestHandler(
+        base::BindRepeating(&HandleRequest));
+    ASSERT_TRUE(embedded_test_server()->Start());
+  }
+
+  bool IsFastPathEnabled() const { return GetParam(); }
+
+  void SetShieldsEnabled(const GURL& url, bool enabled) {
+    brave_shields::SetBraveShieldsEnabled(
+        HostContentSettingsMapFactory::GetForProfile(browser()->profile()),
+        enabled, url);
+  }
+
+  // Loads a page from a.com with images from |image_host|.
+  GURL GetImagesPageURL(const std::string& image_host) {
+    const GURL image_origin =
+        embedded_test_server()->GetURL(image_host, "/").GetOrigin();
+    std::string origin = image_origin.spec();
+    origin.pop_back();
+    return embedded_test_server()->GetURL("a.com", "/images.html?" + origin);
+  }
+
+  // Returns how many requests skipped the handlers while loading |url|.
+  int LoadAndCountSkippedRequests(const GURL& url) {
+    base::HistogramTester histogram_tester;
+    ui_test_utils::NavigateToURL(browser(), url);
+    return histogram_tester.GetBucketCount(kSkippedHandlersHistogram, true);
+  }
+
+ private:
+  base::test::ScopedFeatureList feature_list_;
+};
+
+IN_PROC_BROWSER_TEST_P(BraveRequestHandlerFastPathBrowserTest,
+                       SkipsFirstPartyRequestsWithShieldsDown) {
+  const GURL url = GetImagesPageURL("a.com");
+  SetShieldsEnabled(url, false);
+  EXPECT_EQ(IsFastPathEnabled() ? kSubresourceCount : 0,
+            LoadAndCountSkippedRequests(url));
+}
+
+IN_PROC_BROWSER_TEST_P(BraveRequestHandlerFastPathBrowserTest,
+                       KeepsHandlersWithShieldsUp) {
+  const GURL url = GetImagesPageURL("a.com");
+  SetShieldsEnabled(url, true);
+  EXPECT_EQ(0, LoadAndCountSkippedRequests(url));
+}
+
+IN_PROC_BROWSER_TEST_P(BraveRequestHandlerFastPathBrowserTest,
+                       KeepsHandlersForThirdPartyRequests) {
+  const GURL url = GetImagesPageURL("b.com");
+  SetShieldsEnabled(url, false);
+  EXPECT_EQ(0, LoadAndCountSkippedRequests(url));
+}
+
+// Shields changes made while the tab stays open apply to the next requests.
+IN_PROC_BROWSER_TEST_P(BraveRequestHandlerFastPathBrowserTest,
+                       FollowsShieldsChanges) {
+  const GURL url = GetImagesPageURL("a.com");
+  SetShieldsEnabled(url, false);
+  EXPECT_EQ(IsFastPathEnabled() ? kSubresourceCount : 0,
+            LoadAndCountSkippedRequests(url));
+
+  SetShieldsEnabled(url, true);
+  EXPECT_EQ(0, LoadAndCountSkippedRequests(url));
+
+  SetShieldsEnabled(url, false);
+  EXPECT_EQ(IsFastPathEnabled() ? kSubresourceCount : 0,
+            LoadAndCountSkippedRequests(url));
+}
+
+// The histogram is only recorded when the fast path is enabled.
+IN_PROC_BROWSER_TEST_P(BraveRequestHandlerFastPathBrowserTest,
+                       RecordsSkippedHandlersOnlyWhenEnabled) {
+  const GURL url = GetImagesPageURL("b.com");
+  base::HistogramTester histogram_tester;
+  ui_test_utils::NavigateToURL(browser(), url);
+  if (IsFastPathEnabled()) {
+    EXPECT_GT(histogram_tester.GetAllSamples(kSkippedHandlersHistogram).size(),
+              0u);
+  } else {
+    histogram_tester.ExpectTotalCount(kSkippedHandlersHistogram, 0);
+  }
+}
+
+// The stage and handler latency histograms do not depend on
+// --dump-slow-requests, which only controls the slow request log.
+IN_PROC_BROWSER_TEST_P(BraveRequestHandlerFastPathBrowserTest,
+                       RecordsLatencyHistograms) {
+  const GURL url = GetImagesPageURL("b.com");
+  base::HistogramTester histogram_tester;
+  ui_test_utils::NavigateToURL(browser(), url);
+  EXPECT_GT(histogram_tester.GetAllSamples("Brave.OnBeforeURLRequest_Stage")
+                .size(),
+            0u);
+  EXPECT_GT(histogram_tester
+                .GetAllSamples("Brave.OnBeforeURLRequest_Handler.AdBlockTP")
+                .size(),
+            0u);
+}
+
+INSTANTIATE_TEST_SUITE_P(All,
+                         BraveRequestHandlerFastPathBrowserTest,
+                         testing::Bool());
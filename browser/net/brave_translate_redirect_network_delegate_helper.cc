@@ -54,6 +54,11 @@ bool IsTranslateGen204Request(const GURL& gurl) {
   return is_te_lib && pattern.MatchesURL(gurl);
 }
 
+bool IsTranslateRedirectCandidate(const GURL& gurl) {
+  return IsTranslateGen204Request(gurl) || IsTranslateResourceRequest(gurl) ||
+         IsTranslateScriptRequest(gurl) || IsTranslateRequest(gurl);
+}
+
 int OnBeforeURLRequest_TranslateRedirectWork(
     const ResponseCallback& next_callback,
     std::shared_ptr<BraveRequestInfo> ctx) {
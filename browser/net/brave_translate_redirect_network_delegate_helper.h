@@ -11,6 +11,10 @@
 
 namespace brave {
 
+// Returns true if |gurl| is a request that
+// OnBeforeURLRequest_TranslateRedirectWork may abort or redirect.
+bool IsTranslateRedirectCandidate(const GURL& gurl);
+
 int OnBeforeURLRequest_TranslateRedirectWork(
     const ResponseCallback& next_callback,
     std::shared_ptr<BraveRequestInfo> ctx);
@@ -0,0 +1,127 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/browser/net/request_timing_log.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/command_line.h"
+#include "base/json/json_writer.h"
+#include "base/logging.h"
+#include "base/no_destructor.h"
+#include "brave/common/brave_switches.h"
+
+namespace brave {
+
+namespace {
+
+const size_t kWindowSize = 1000;
+const size_t kDumpSize = 20;
+
+base::Value TimesToValue(
+    const base::flat_map<std::string, base::TimeDelta>& times) {
+  base::Value value(base::Value::Type::DICTIONARY);
+  for (const auto& time : times)
+    value.SetDoubleKey(time.first, time.second.InMillisecondsF());
+  return value;
+}
+
+}  // namespace
+
+RequestTiming::RequestTiming() = default;
+
+RequestTiming::RequestTiming(const RequestTiming& other) = default;
+
+RequestTiming& RequestTiming::operator=(const RequestTiming& other) = default;
+
+RequestTiming::~RequestTiming() = default;
+
+base::TimeDelta RequestTiming::total() const {
+  base::TimeDelta total;
+  for (const auto& stage : stages)
+    total += stage.second;
+  return total;
+}
+
+base::Value RequestTiming::ToValue() const {
+  base::Value value(base::Value::Type::DICTIONARY);
+  value.SetDoubleKey("total_ms", total().InMillisecondsF());
+  value.SetKey("stages_ms", TimesToValue(stages));
+  value.SetKey("handlers_ms", TimesToValue(handlers));
+  value.SetDoubleKey("adblock_queue_ms", adblock_queue_time.InMillisecondsF());
+  value.SetDoubleKey("cname_resolution_ms",
+                     cname_resolution_time.InMillisecondsF());
+  return value;
+}
+
+RequestTimingLog::RequestTimingLog(size_t window_size,
+                                   size_t dump_size,
+                                   bool dump_to_log)
+    : window_size_(window_size),
+      dump_size_(dump_size),
+      dump_to_log_(dump_to_log) {
+  entries_.reserve(window_size_);
+}
+
+RequestTimingLog::~RequestTimingLog() = default;
+
+// static
+bool RequestTimingLog::IsEnabled() {
+  static const bool enabled =
+      base::CommandLine::ForCurrentProcess()->HasSwitch(
+          switches::kDumpSlowRequests);
+  return enabled;
+}
+
+// static
+RequestTimingLog* RequestTimingLog::GetInstance() {
+  DCHECK(IsEnabled());
+  static base::NoDestructor<RequestTimingLog> instance(kWindowSize, kDumpSize,
+                                                       true);
+  return instance.get();
+}
+
+void RequestTimingLog::Add(const GURL& url, const RequestTiming& timing) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  entries_.push_back({url.GetOrigin(), timing});
+  if (entries_.size() < window_size_)
+    return;
+  if (dump_to_log_)
+    DumpToLog();
+  entries_.clear();
+}
+
+base::Value RequestTimingLog::GetSlowestRequests(size_t count) const {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  std::vector<const Entry*> slowest;
+  slowest.reserve(entries_.size());
+  for (const Entry& entry : entries_)
+    slowest.push_back(&entry);
+  count = std::min(count, slowest.size());
+  std::partial_sort(slowest.begin(), slowest.begin() + count, slowest.end(),
+                    [](const Entry* a, const Entry* b) {
+                      return a->timing.total() > b->timing.total();
+                    });
+
+  base::Value list(base::Value::Type::LIST);
+  for (size_t i = 0; i < count; ++i) {
+    base::Value value = slowest[i]->timing.ToValue();
+    value.SetStringKey("origin", slowest[i]->origin.spec());
+    list.Append(std::move(value));
+  }
+  return list;
+}
+
+void RequestTimingLog::DumpToLog() {
+  std::string json;
+  base::JSONWriter::WriteWithOptions(GetSlowestRequests(dump_size_),
+                                     base::JSONWriter::OPTIONS_PRETTY_PRINT,
+                                     &json);
+  LOG(INFO) << "Slowest of the last " << entries_.size()
+            << " requests: " << json;
+}
+
+}  // namespace brave
@@ -0,0 +1,86 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_BROWSER_NET_REQUEST_TIMING_LOG_H_
+#define BRAVE_BROWSER_NET_REQUEST_TIMING_LOG_H_
+
+#include <string>
+#include <vector>
+
+#include "base/containers/flat_map.h"
+#include "base/macros.h"
+#include "base/sequence_checker.h"
+#include "base/time/time.h"
+#include "base/values.h"
+#include "url/gurl.h"
+
+namespace brave {
+
+// Where a request spent its time in the network hooks, over all of its
+// stages.
+struct RequestTiming {
+  RequestTiming();
+  RequestTiming(const RequestTiming& other);
+  RequestTiming& operator=(const RequestTiming& other);
+  ~RequestTiming();
+
+  // Time from a stage's hook until its result, by stage name.
+  base::flat_map<std::string, base::TimeDelta> stages;
+  // Time spent in each handler, by "<stage>.<handler>".
+  base::flat_map<std::string, base::TimeDelta> handlers;
+  // Time ad block checks waited for their matching sequence.
+  base::TimeDelta adblock_queue_time;
+  base::TimeDelta cname_resolution_time;
+
+  base::TimeDelta total() const;
+  base::Value ToValue() const;
+};
+
+// Keeps the timings of the recently completed requests so the slowest ones
+// can be dumped when looking for regressions. With --dump-slow-requests the
+// slowest requests are logged each time |window_size| requests completed.
+// Without it, requests are not added to the log, while their stage and
+// handler histograms are still recorded by BraveRequestHandler.
+//
+// Must be used on the UI thread.
+class RequestTimingLog {
+ public:
+  RequestTimingLog(size_t window_size, size_t dump_size, bool dump_to_log);
+  ~RequestTimingLog();
+
+  // Whether requests should be added to the log, i.e. whether
+  // --dump-slow-requests was passed.
+  static bool IsEnabled();
+  static RequestTimingLog* GetInstance();
+
+  void Add(const GURL& url, const RequestTiming& timing);
+  // Returns the |count| slowest requests of the current window, slowest
+  // first.
+  base::Value GetSlowestRequests(size_t count) const;
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    // Only the origin is kept, the log is meant to be shared.
+    GURL origin;
+    RequestTiming timing;
+  };
+
+  void DumpToLog();
+
+  const size_t window_size_;
+  const size_t dump_size_;
+  const bool dump_to_log_;
+  std::vector<Entry> entries_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+
+  DISALLOW_COPY_AND_ASSIGN(RequestTimingLog);
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_BROWSER_NET_REQUEST_TIMING_LOG_H_
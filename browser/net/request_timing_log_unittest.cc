@@ -0,0 +1,67 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/browser/net/request_timing_log.h"
+
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+
+using brave::RequestTiming;
+using brave::RequestTimingLog;
+
+namespace {
+
+RequestTiming MakeTiming(int before_url_request_ms, int headers_received_ms) {
+  RequestTiming timing;
+  timing.stages["OnBeforeURLRequest"] =
+      base::TimeDelta::FromMilliseconds(before_url_request_ms);
+  timing.stages["OnHeadersReceived"] =
+      base::TimeDelta::FromMilliseconds(headers_received_ms);
+  timing.handlers["OnBeforeURLRequest.AdBlockTP"] =
+      base::TimeDelta::FromMilliseconds(before_url_request_ms);
+  return timing;
+}
+
+}  // namespace
+
+TEST(RequestTimingLogTest, TotalSumsStages) {
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(7),
+            MakeTiming(3, 4).total());
+  EXPECT_TRUE(RequestTiming().total().is_zero());
+}
+
+TEST(RequestTimingLogTest, ListsSlowestRequestsFirst) {
+  RequestTimingLog log(10, 2, false);
+  log.Add(GURL("https://fast.com/a?q=1"), MakeTiming(1, 1));
+  log.Add(GURL("https://slowest.com/b"), MakeTiming(20, 5));
+  log.Add(GURL("https://slow.com/c"), MakeTiming(10, 0));
+
+  base::Value slowest = log.GetSlowestRequests(2);
+  ASSERT_TRUE(slowest.is_list());
+  ASSERT_EQ(2u, slowest.GetList().size());
+  // Only the origin of the request is kept.
+  EXPECT_EQ("https://slowest.com/",
+            *slowest.GetList()[0].FindStringKey("origin"));
+  EXPECT_EQ(25, *slowest.GetList()[0].FindDoubleKey("total_ms"));
+  const base::Value* handlers =
+      slowest.GetList()[0].FindDictKey("handlers_ms");
+  ASSERT_TRUE(handlers);
+  EXPECT_EQ(20, *handlers->FindDoubleKey("OnBeforeURLRequest.AdBlockTP"));
+  EXPECT_EQ("https://slow.com/",
+            *slowest.GetList()[1].FindStringKey("origin"));
+
+  EXPECT_EQ(3u, log.GetSlowestRequests(10).GetList().size());
+}
+
+TEST(RequestTimingLogTest, StartsOverAfterEachWindow) {
+  RequestTimingLog log(3, 2, false);
+  log.Add(GURL("https://a.com/"), MakeTiming(1, 1));
+  log.Add(GURL("https://b.com/"), MakeTiming(1, 1));
+  EXPECT_EQ(2u, log.size());
+  log.Add(GURL("https://c.com/"), MakeTiming(1, 1));
+  EXPECT_EQ(0u, log.size());
+  log.Add(GURL("https://d.com/"), MakeTiming(1, 1));
+  EXPECT_EQ(1u, log.size());
+}
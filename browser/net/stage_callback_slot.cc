@@ -0,0 +1,35 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/browser/net/stage_callback_slot.h"
+
+#include <utility>
+
+#include "base/logging.h"
+
+namespace brave {
+
+StageCallbackSlot::StageCallbackSlot() = default;
+
+StageCallbackSlot::~StageCallbackSlot() = default;
+
+uint32_t StageCallbackSlot::Arm(net::CompletionOnceCallback callback) {
+  DCHECK(callback);
+  callback_ = std::move(callback);
+  return ++generation_;
+}
+
+net::CompletionOnceCallback StageCallbackSlot::Take() {
+  DCHECK(is_pending());
+  ++generation_;
+  return std::move(callback_);
+}
+
+void StageCallbackSlot::Reset() {
+  ++generation_;
+  callback_.Reset();
+}
+
+}  // namespace brave
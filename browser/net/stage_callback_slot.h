@@ -0,0 +1,50 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_BROWSER_NET_STAGE_CALLBACK_SLOT_H_
+#define BRAVE_BROWSER_NET_STAGE_CALLBACK_SLOT_H_
+
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "net/base/completion_once_callback.h"
+
+namespace brave {
+
+// Holds the completion callback of the stage a request is in.
+//
+// Every stage gets a new generation. Handlers carry the generation they were
+// started in, so a handler answering for an earlier stage, or for a request
+// that went away, is told apart without looking anything up.
+class StageCallbackSlot {
+ public:
+  StageCallbackSlot();
+  ~StageCallbackSlot();
+
+  // Stores |callback| for a new stage and returns the stage's generation.
+  uint32_t Arm(net::CompletionOnceCallback callback);
+
+  // Returns true if the stage of |generation| still waits for its result.
+  bool IsPending(uint32_t generation) const {
+    return generation == generation_ && !callback_.is_null();
+  }
+  bool is_pending() const { return !callback_.is_null(); }
+  uint32_t generation() const { return generation_; }
+
+  // Ends the stage and returns its callback.
+  net::CompletionOnceCallback Take();
+  // Ends the stage without running its callback.
+  void Reset();
+
+ private:
+  net::CompletionOnceCallback callback_;
+  uint32_t generation_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(StageCallbackSlot);
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_BROWSER_NET_STAGE_CALLBACK_SLOT_H_
@@ -0,0 +1,90 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/browser/net/stage_callback_slot.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/stl_util.h"
+#include "base/test/task_environment.h"
+#include "base/threading/sequenced_task_runner_handle.h"
+#include "base/timer/elapsed_timer.h"
+#include "net/base/net_errors.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+using brave::StageCallbackSlot;
+
+namespace {
+
+// Requests in flight at once, each going through three stages of
+// |kHandlersPerStage| handlers.
+const int kRequests = 10000;
+const int kStages = 3;
+const int kHandlersPerStage = 5;
+
+void OnComplete(int* completed, int rv) {
+  ++*completed;
+}
+
+}  // namespace
+
+// Compares the map of pending callbacks the request handler used to keep,
+// looked up at every handler step and answered through a posted task, with a
+// slot per request answered inline, at a high request rate.
+TEST(StageCallbackSlotPerfTest, HighRequestRate) {
+  base::test::SingleThreadTaskEnvironment task_environment;
+  int completed = 0;
+
+  base::ElapsedTimer map_timer;
+  std::map<uint64_t, net::CompletionOnceCallback> callbacks;
+  for (int stage = 0; stage < kStages; ++stage) {
+    for (int id = 0; id < kRequests; ++id)
+      callbacks[id] = base::BindOnce(&OnComplete, &completed);
+    for (int handler = 0; handler < kHandlersPerStage; ++handler) {
+      for (int id = 0; id < kRequests; ++id)
+        ASSERT_TRUE(base::Contains(callbacks, id));
+    }
+    for (int id = 0; id < kRequests; ++id) {
+      auto it = callbacks.find(id);
+      base::SequencedTaskRunnerHandle::Get()->PostTask(
+          FROM_HERE, base::BindOnce(std::move(it->second), net::OK));
+    }
+    task_environment.RunUntilIdle();
+  }
+  callbacks.clear();
+  const base::TimeDelta map_time = map_timer.Elapsed();
+  EXPECT_EQ(kStages * kRequests, completed);
+
+  completed = 0;
+  base::ElapsedTimer slot_timer;
+  std::vector<std::unique_ptr<StageCallbackSlot>> slots;
+  for (int id = 0; id < kRequests; ++id)
+    slots.push_back(std::make_unique<StageCallbackSlot>());
+  std::vector<uint32_t> generations(kRequests);
+  for (int stage = 0; stage < kStages; ++stage) {
+    for (int id = 0; id < kRequests; ++id)
+      generations[id] = slots[id]->Arm(base::BindOnce(&OnComplete, &completed));
+    for (int handler = 0; handler < kHandlersPerStage; ++handler) {
+      for (int id = 0; id < kRequests; ++id)
+        ASSERT_TRUE(slots[id]->IsPending(generations[id]));
+    }
+    for (int id = 0; id < kRequests; ++id)
+      slots[id]->Take().Run(net::OK);
+  }
+  slots.clear();
+  const base::TimeDelta slot_time = slot_timer.Elapsed();
+  EXPECT_EQ(kStages * kRequests, completed);
+
+  const int stage_count = kStages * kRequests;
+  perf_test::PerfResultReporter reporter("StageCallbackSlot", "stage");
+  reporter.RegisterImportantMetric(".map_and_post", "us");
+  reporter.RegisterImportantMetric(".slot_inline", "us");
+  reporter.AddResult(".map_and_post", map_time / stage_count);
+  reporter.AddResult(".slot_inline", slot_time / stage_count);
+}
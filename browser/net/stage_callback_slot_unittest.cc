@@ -0,0 +1,56 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/browser/net/stage_callback_slot.h"
+
+#include "base/bind.h"
+#include "net/base/net_errors.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using brave::StageCallbackSlot;
+
+namespace {
+
+void OnComplete(int* completed, int* last_rv, int rv) {
+  ++*completed;
+  *last_rv = rv;
+}
+
+net::CompletionOnceCallback MakeCallback(int* completed, int* last_rv) {
+  return base::BindOnce(&OnComplete, completed, last_rv);
+}
+
+}  // namespace
+
+TEST(StageCallbackSlotTest, RunsCallbackOnce) {
+  int completed = 0;
+  int last_rv = net::OK;
+  StageCallbackSlot slot;
+  EXPECT_FALSE(slot.is_pending());
+
+  uint32_t generation = slot.Arm(MakeCallback(&completed, &last_rv));
+  EXPECT_TRUE(slot.IsPending(generation));
+  slot.Take().Run(net::ERR_BLOCKED_BY_CLIENT);
+  EXPECT_EQ(1, completed);
+  EXPECT_EQ(net::ERR_BLOCKED_BY_CLIENT, last_rv);
+  EXPECT_FALSE(slot.is_pending());
+  EXPECT_FALSE(slot.IsPending(generation));
+}
+
+TEST(StageCallbackSlotTest, IgnoresEarlierStages) {
+  int completed = 0;
+  int last_rv = net::OK;
+  StageCallbackSlot slot;
+
+  uint32_t first = slot.Arm(MakeCallback(&completed, &last_rv));
+  uint32_t second = slot.Arm(MakeCallback(&completed, &last_rv));
+  EXPECT_NE(first, second);
+  EXPECT_FALSE(slot.IsPending(first));
+  EXPECT_TRUE(slot.IsPending(second));
+
+  slot.Reset();
+  EXPECT_FALSE(slot.IsPending(second));
+  EXPECT_EQ(0, completed);
+}
@@ -0,0 +1,97 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/browser/net/tab_request_policy.h"
+
+#include "brave/components/brave_shields/browser/brave_shields_util.h"
+#include "chrome/browser/content_settings/host_content_settings_map_factory.h"
+#include "chrome/browser/profiles/profile.h"
+#include "content/public/browser/browser_thread.h"
+#include "content/public/browser/navigation_handle.h"
+#include "content/public/browser/web_contents.h"
+
+namespace brave {
+
+// static
+TabRequestPolicy TabRequestPolicy::Create(
+    content::BrowserContext* browser_context,
+    const GURL& tab_origin) {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  TabRequestPolicy policy;
+  policy.tab_origin = tab_origin;
+  auto* map = HostContentSettingsMapFactory::GetForProfile(
+      Profile::FromBrowserContext(browser_context));
+  policy.shields_up = brave_shields::GetBraveShieldsEnabled(map, tab_origin);
+  policy.allow_ads = brave_shields::GetAdControlType(map, tab_origin) ==
+                     brave_shields::ControlType::ALLOW;
+  policy.allow_http_upgradable_resource =
+      !brave_shields::GetHTTPSEverywhereEnabled(map, tab_origin);
+  policy.allow_referrers = brave_shields::AllowReferrers(map, tab_origin);
+  return policy;
+}
+
+TabRequestPolicyCache::TabRequestPolicyCache(
+    content::WebContents* web_contents)
+    : WebContentsObserver(web_contents),
+      tab_origin_(web_contents->GetURL().GetOrigin()) {
+  content_settings_observer_.Add(HostContentSettingsMapFactory::GetForProfile(
+      Profile::FromBrowserContext(web_contents->GetBrowserContext())));
+}
+
+TabRequestPolicyCache::~TabRequestPolicyCache() = default;
+
+// static
+TabRequestPolicyCache* TabRequestPolicyCache::FromFrameTreeNodeId(
+    int frame_tree_node_id) {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  content::WebContents* web_contents =
+      content::WebContents::FromFrameTreeNodeId(frame_tree_node_id);
+  if (!web_contents)
+    return nullptr;
+  CreateForWebContents(web_contents);
+  return FromWebContents(web_contents);
+}
+
+// static
+TabRequestPolicy TabRequestPolicyCache::GetPolicy(
+    content::BrowserContext* browser_context,
+    int frame_tree_node_id,
+    const GURL& tab_origin) {
+  TabRequestPolicyCache* cache = FromFrameTreeNodeId(frame_tree_node_id);
+  if (cache && cache->tab_origin_ == tab_origin)
+    return cache->Get();
+  return TabRequestPolicy::Create(browser_context, tab_origin);
+}
+
+const TabRequestPolicy& TabRequestPolicyCache::Get() {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  if (!policy_) {
+    policy_ = TabRequestPolicy::Create(web_contents()->GetBrowserContext(),
+                                       tab_origin_);
+  }
+  return *policy_;
+}
+
+void TabRequestPolicyCache::DidFinishNavigation(
+    content::NavigationHandle* navigation_handle) {
+  if (!navigation_handle->IsInMainFrame())
+    return;
+  tab_origin_ = web_contents()->GetURL().GetOrigin();
+  policy_.reset();
+}
+
+void TabRequestPolicyCache::OnContentSettingChanged(
+    const ContentSettingsPattern& primary_pattern,
+    const ContentSettingsPattern& secondary_pattern,
+    ContentSettingsType content_type,
+    const std::string& resource_identifier) {
+  // Shields settings are all stored as plugin settings.
+  if (content_type == ContentSettingsType::PLUGINS)
+    policy_.reset();
+}
+
+WEB_CONTENTS_USER_DATA_KEY_IMPL(TabRequestPolicyCache)
+
+}  // namespace brave
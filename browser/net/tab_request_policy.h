@@ -0,0 +1,92 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_BROWSER_NET_TAB_REQUEST_POLICY_H_
+#define BRAVE_BROWSER_NET_TAB_REQUEST_POLICY_H_
+
+#include <string>
+
+#include "base/macros.h"
+#include "base/optional.h"
+#include "base/scoped_observer.h"
+#include "components/content_settings/core/browser/content_settings_observer.h"
+#include "components/content_settings/core/browser/host_content_settings_map.h"
+#include "content/public/browser/web_contents_observer.h"
+#include "content/public/browser/web_contents_user_data.h"
+#include "url/gurl.h"
+
+namespace content {
+class BrowserContext;
+}
+
+namespace brave {
+
+// The shields settings of the tab a request is made from. See
+// BraveRequestHandler::CanSkipOnBeforeURLRequest.
+struct TabRequestPolicy {
+  static TabRequestPolicy Create(content::BrowserContext* browser_context,
+                                 const GURL& tab_origin);
+
+  GURL tab_origin;
+  bool shields_up = true;
+  bool allow_ads = false;
+  bool allow_http_upgradable_resource = false;
+  bool allow_referrers = false;
+};
+
+// Keeps the TabRequestPolicy of a tab so that it is looked up once for all
+// the requests the tab makes. It is dropped when the tab navigates or when
+// shields settings change.
+class TabRequestPolicyCache
+    : public content::WebContentsObserver,
+      public content::WebContentsUserData<TabRequestPolicyCache>,
+      public content_settings::Observer {
+ public:
+  ~TabRequestPolicyCache() override;
+
+  // Returns the cache of the tab |frame_tree_node_id| is in, creating it if
+  // needed, or null if the frame is not in a tab.
+  static TabRequestPolicyCache* FromFrameTreeNodeId(int frame_tree_node_id);
+
+  // Returns the policy of |tab_origin| in the tab of |frame_tree_node_id|.
+  // It comes from the cache when the tab is at |tab_origin|, which it is not
+  // during the navigation away from another origin.
+  static TabRequestPolicy GetPolicy(content::BrowserContext* browser_context,
+                                    int frame_tree_node_id,
+                                    const GURL& tab_origin);
+
+  // Returns the policy of the origin the tab is at.
+  const TabRequestPolicy& Get();
+
+ private:
+  friend class content::WebContentsUserData<TabRequestPolicyCache>;
+
+  explicit TabRequestPolicyCache(content::WebContents* web_contents);
+
+  // content::WebContentsObserver:
+  void DidFinishNavigation(
+      content::NavigationHandle* navigation_handle) override;
+
+  // content_settings::Observer:
+  void OnContentSettingChanged(const ContentSettingsPattern& primary_pattern,
+                               const ContentSettingsPattern& secondary_pattern,
+                               ContentSettingsType content_type,
+                               const std::string& resource_identifier) override;
+
+  // Same as the tab URL BraveShieldsWebContentsObserver keeps for the frames
+  // of the tab, and updated at the same time.
+  GURL tab_origin_;
+  base::Optional<TabRequestPolicy> policy_;
+
+  ScopedObserver<HostContentSettingsMap, content_settings::Observer>
+      content_settings_observer_{this};
+
+  WEB_CONTENTS_USER_DATA_KEY_DECL();
+  DISALLOW_COPY_AND_ASSIGN(TabRequestPolicyCache);
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_BROWSER_NET_TAB_REQUEST_POLICY_H_
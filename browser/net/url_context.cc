@@ -8,6 +8,7 @@
 #include <memory>
 #include <string>
 
+#include "brave/browser/net/tab_request_policy.h"
 #include "brave/components/brave_shields/browser/brave_shields_util.h"
 #include "brave/components/brave_shields/browser/brave_shields_web_contents_observer.h"
 #include "brave/components/brave_webtorrent/browser/buildflags/buildflags.h"
@@ -17,6 +18,7 @@
 #include "chrome/browser/profiles/profile.h"
 #include "content/public/browser/browser_thread.h"
 #include "net/base/isolation_info.h"
+#include "services/network/public/cpp/resource_request.h"
 
 #if BUILDFLAG(IPFS_ENABLED)
 #include "brave/components/ipfs/pref_names.h"
@@ -29,30 +31,63 @@
 
 namespace brave {
 
-namespace {
+BraveRequestInfo::BraveRequestInfo() = default;
 
-std::string GetUploadData(const network::ResourceRequest& request) {
-  std::string upload_data;
-  if (!request.request_body) {
-    return {};
-  }
-  const auto* elements = request.request_body->elements();
-  for (const network::DataElement& element : *elements) {
+BraveRequestInfo::BraveRequestInfo(const GURL& url) : request_url(url) {}
+
+BraveRequestInfo::~BraveRequestInfo() = default;
+
+base::StringPiece BraveRequestInfo::GetUploadData() const {
+  DCHECK(!running_handler_reads_ ||
+         (*running_handler_reads_ & kUploadDataFields))
+      << "OnBeforeURLRequest handlers must declare kUploadDataFields to read "
+         "the request body";
+  if (!request_body_)
+    return base::StringPiece();
+  if (joined_upload_data_)
+    return *joined_upload_data_;
+
+  const network::DataElement* bytes_element = nullptr;
+  size_t bytes_element_count = 0;
+  for (const network::DataElement& element : *request_body_->elements()) {
     if (element.type() == network::mojom::DataElementType::kBytes) {
-      upload_data.append(element.bytes(), element.length());
+      bytes_element = &element;
+      ++bytes_element_count;
     }
   }
-
-  return upload_data;
+  if (bytes_element_count == 0)
+    return base::StringPiece();
+  if (bytes_element_count == 1)
+    return base::StringPiece(bytes_element->bytes(), bytes_element->length());
+
+  joined_upload_data_.emplace();
+  for (const network::DataElement& element : *request_body_->elements()) {
+    if (element.type() == network::mojom::DataElementType::kBytes)
+      joined_upload_data_->append(element.bytes(), element.length());
+  }
+  return *joined_upload_data_;
 }
 
-}  // namespace
-
-BraveRequestInfo::BraveRequestInfo() = default;
-
-BraveRequestInfo::BraveRequestInfo(const GURL& url) : request_url(url) {}
-
-BraveRequestInfo::~BraveRequestInfo() = default;
+void BraveRequestInfo::ResetStageState() {
+  tab_origin = GURL();
+  new_referrer.reset();
+  new_url_spec.clear();
+  next_url_request_index = 0;
+  handler_progress_.clear();
+  handler_start_time_ = base::TimeTicks();
+  headers = nullptr;
+  set_headers.clear();
+  removed_headers.clear();
+  original_response_headers = nullptr;
+  override_response_headers = nullptr;
+  allowed_unsafe_redirect_url = nullptr;
+  event_type = kUnknownEventType;
+  referral_headers_list = nullptr;
+  blocked_by = kNotBlocked;
+  mock_data_url.clear();
+  network_isolation_key = net::NetworkIsolationKey();
+  new_url = nullptr;
+}
 
 // static
 std::shared_ptr<brave::BraveRequestInfo> BraveRequestInfo::MakeCTX(
@@ -64,7 +99,22 @@ std::shared_ptr<brave::BraveRequestInfo> BraveRequestInfo::MakeCTX(
     std::shared_ptr<brave::BraveRequestInfo> old_ctx) {
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
 
-  auto ctx = std::make_shared<brave::BraveRequestInfo>();
+  // A request keeps the same context through all of its stages, including
+  // |internal_redirect| and |redirect_source| which the proxies update
+  // between them, so nothing is derived twice unless its inputs changed.
+  std::shared_ptr<brave::BraveRequestInfo> ctx = old_ctx;
+  const bool is_first_stage =
+      !ctx || ctx->request_identifier != request_identifier;
+  if (is_first_stage) {
+    ctx = std::make_shared<brave::BraveRequestInfo>();
+    if (old_ctx) {
+      ctx->internal_redirect = old_ctx->internal_redirect;
+      ctx->redirect_source = old_ctx->redirect_source;
+    }
+  } else {
+    ctx->ResetStageState();
+  }
+
   ctx->request_identifier = request_identifier;
   ctx->method = request.method;
   ctx->request_url = request.url;
@@ -78,13 +128,6 @@ std::shared_ptr<brave::BraveRequestInfo> BraveRequestInfo::MakeCTX(
   ctx->resource_type =
       static_cast<blink::mojom::ResourceType>(request.resource_type);
 
-  ctx->is_webtorrent_disabled =
-#if BUILDFLAG(ENABLE_BRAVE_WEBTORRENT)
-      !webtorrent::IsWebtorrentEnabled(browser_context);
-#else
-      true;
-#endif
-
   ctx->render_frame_id = request.render_frame_id;
   ctx->render_process_id = render_process_id;
   ctx->frame_tree_node_id = frame_tree_node_id;
@@ -114,45 +157,55 @@ std::shared_ptr<brave::BraveRequestInfo> BraveRequestInfo::MakeCTX(
                               .GetOrigin();
   }
 
-  if (old_ctx) {
-    ctx->internal_redirect = old_ctx->internal_redirect;
-    ctx->redirect_source = old_ctx->redirect_source;
+  // The shields settings only depend on the tab origin and, for referrers,
+  // on the redirect source, so later stages usually keep them.
+  if (!ctx->settings_valid_ || ctx->settings_tab_origin_ != ctx->tab_origin ||
+      ctx->settings_redirect_source_ != ctx->redirect_source) {
+    const TabRequestPolicy policy = TabRequestPolicyCache::GetPolicy(
+        browser_context, frame_tree_node_id, ctx->tab_origin);
+    ctx->allow_brave_shields = policy.shields_up;
+    ctx->allow_ads = policy.allow_ads;
+    ctx->allow_http_upgradable_resource =
+        policy.allow_http_upgradable_resource;
+
+    // HACK: |tab_origin| changes during consequent stages of navigation, and
+    // so would the |allow_referrers| flag, which is not what we want for
+    // determining referrers.
+    if (ctx->redirect_source.is_empty()) {
+      ctx->allow_referrers = policy.allow_referrers;
+    } else {
+      Profile* profile = Profile::FromBrowserContext(browser_context);
+      auto* map = HostContentSettingsMapFactory::GetForProfile(profile);
+      ctx->allow_referrers =
+          brave_shields::AllowReferrers(map, ctx->redirect_source);
+    }
+    ctx->settings_tab_origin_ = ctx->tab_origin;
+    ctx->settings_redirect_source_ = ctx->redirect_source;
+    ctx->settings_valid_ = true;
   }
 
-  Profile* profile = Profile::FromBrowserContext(browser_context);
-  auto* map = HostContentSettingsMapFactory::GetForProfile(profile);
-  ctx->allow_brave_shields =
-      brave_shields::GetBraveShieldsEnabled(map, ctx->tab_origin);
-  ctx->allow_ads = brave_shields::GetAdControlType(
-      map, ctx->tab_origin) == brave_shields::ControlType::ALLOW;
-  ctx->allow_http_upgradable_resource =
-      !brave_shields::GetHTTPSEverywhereEnabled(map, ctx->tab_origin);
-
-  // HACK: after we fix multiple creations of BraveRequestInfo we should
-  // use only tab_origin. Since we recreate BraveRequestInfo during consequent
-  // stages of navigation, |tab_origin| changes and so does |allow_referrers|
-  // flag, which is not what we want for determining referrers.
-  ctx->allow_referrers = brave_shields::AllowReferrers(
-      map, ctx->redirect_source.is_empty() ? ctx->tab_origin :
-                                             ctx->redirect_source);
-  ctx->upload_data = GetUploadData(request);
+  if (ctx->request_body_ != request.request_body) {
+    ctx->request_body_ = request.request_body;
+    ctx->joined_upload_data_.reset();
+  }
 
-#if BUILDFLAG(IPFS_ENABLED)
-  auto* prefs = user_prefs::UserPrefs::Get(browser_context);
-  bool local = static_cast<ipfs::IPFSResolveMethodTypes>(
-      prefs->GetInteger(kIPFSResolveMethod)) ==
-          ipfs::IPFSResolveMethodTypes::IPFS_LOCAL;
-  ctx->ipfs_gateway_url = local ?
-      ipfs::GetDefaultIPFSLocalGateway(chrome::GetChannel()) :
-      ipfs::GetDefaultIPFSGateway();
+  if (is_first_stage) {
+    ctx->is_webtorrent_disabled =
+#if BUILDFLAG(ENABLE_BRAVE_WEBTORRENT)
+        !webtorrent::IsWebtorrentEnabled(browser_context);
+#else
+        true;
 #endif
 
-  // TODO(fmarier): remove this once the hacky code in
-  // brave_proxying_url_loader_factory.cc is refactored. See
-  // BraveProxyingURLLoaderFactory::InProgressRequest::UpdateRequestInfo().
-  if (old_ctx) {
-    ctx->internal_redirect = old_ctx->internal_redirect;
-    ctx->redirect_source = old_ctx->redirect_source;
+#if BUILDFLAG(IPFS_ENABLED)
+    auto* prefs = user_prefs::UserPrefs::Get(browser_context);
+    bool local = static_cast<ipfs::IPFSResolveMethodTypes>(
+        prefs->GetInteger(kIPFSResolveMethod)) ==
+            ipfs::IPFSResolveMethodTypes::IPFS_LOCAL;
+    ctx->ipfs_gateway_url = local ?
+        ipfs::GetDefaultIPFSLocalGateway(chrome::GetChannel()) :
+        ipfs::GetDefaultIPFSGateway();
+#endif
   }
 
   return ctx;
@@ -9,7 +9,14 @@
 #include <memory>
 #include <set>
 #include <string>
-
+#include <vector>
+
+#include "base/memory/scoped_refptr.h"
+#include "base/optional.h"
+#include "base/strings/string_piece.h"
+#include "base/time/time.h"
+#include "brave/browser/net/request_timing_log.h"
+#include "brave/browser/net/stage_callback_slot.h"
 #include "net/base/network_isolation_key.h"
 #include "net/http/http_request_headers.h"
 #include "net/http/http_response_headers.h"
@@ -24,6 +31,7 @@ class BrowserContext;
 }
 
 namespace network {
+class ResourceRequestBody;
 struct ResourceRequest;
 }
 
@@ -50,6 +58,25 @@ enum BraveNetworkDelegateEventType {
 
 enum BlockedBy { kNotBlocked, kAdBlocked, kOtherBlocked };
 
+// Groups of BraveRequestInfo fields that OnBeforeURLRequest handlers declare
+// they read or write, see BraveRequestHandler::AddBeforeURLRequestHandler.
+enum RequestInfoFields : uint32_t {
+  kNoFields = 0,
+  // What describes the request and is not changed by handlers: URLs, shields
+  // settings, ids, referrer...
+  kRequestFields = 1 << 0,
+  // |new_url_spec|.
+  kNewURLFields = 1 << 1,
+  // |new_referrer|.
+  kNewReferrerFields = 1 << 2,
+  // |set_headers| and |removed_headers|.
+  kHeaderChangesFields = 1 << 3,
+  // |blocked_by| and |mock_data_url|.
+  kBlockedByFields = 1 << 4,
+  // The request body, see BraveRequestInfo::GetUploadData().
+  kUploadDataFields = 1 << 5,
+};
+
 struct BraveRequestInfo {
   BraveRequestInfo();
 
@@ -113,8 +140,18 @@ struct BraveRequestInfo {
       static_cast<blink::mojom::ResourceType>(-1);
   blink::mojom::ResourceType resource_type = kInvalidResourceType;
 
-  std::string upload_data;
+  // Kept over all the stages of the request.
+  RequestTiming timing;
+
+  // Returns the bytes of the request body. The body is shared with the
+  // request rather than copied into every context, so handlers that need it
+  // should call this only once they know they do. The bytes are only copied
+  // when they are split over several elements. OnBeforeURLRequest handlers
+  // must declare kUploadDataFields in what they read to call this.
+  base::StringPiece GetUploadData() const;
 
+  // Returns |old_ctx| updated in place for the next stage of the same
+  // request, or a new context for a request's first stage.
   static std::shared_ptr<brave::BraveRequestInfo>
       MakeCTX(const network::ResourceRequest& request,
               int render_process_id,
@@ -128,8 +165,41 @@ struct BraveRequestInfo {
   // We should also remove the one below.
   friend class ::BraveRequestHandler;
 
+  // Progress of an OnBeforeURLRequest handler during the current stage.
+  struct HandlerProgress {
+    // Null until the handler is started.
+    base::TimeTicks start_time;
+    bool done = false;
+    int rv = 0;
+  };
+
+  // Clears what the handlers of the previous stage produced.
+  void ResetStageState();
+
   GURL* new_url = nullptr;
 
+  // Callback of the stage in progress. While the handler's hook for the stage
+  // runs, |in_stage_hook_| is set and a result reached right away is kept in
+  // |stage_result_| for the hook to return.
+  StageCallbackSlot stage_callback_;
+  bool in_stage_hook_ = false;
+  int stage_result_ = 0;
+
+  std::vector<HandlerProgress> handler_progress_;
+  bool running_handlers_ = false;
+  // What the OnBeforeURLRequest handler being called declared it reads.
+  base::Optional<uint32_t> running_handler_reads_;
+  base::TimeTicks stage_start_time_;
+  // Start of the running handler of a stage whose handlers run in sequence.
+  base::TimeTicks handler_start_time_;
+
+  scoped_refptr<network::ResourceRequestBody> request_body_;
+  mutable base::Optional<std::string> joined_upload_data_;
+  // The inputs the shields settings above were last looked up for.
+  GURL settings_tab_origin_;
+  GURL settings_redirect_source_;
+  bool settings_valid_ = false;
+
   DISALLOW_COPY_AND_ASSIGN(BraveRequestInfo);
 };
 
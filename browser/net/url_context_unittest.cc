@@ -0,0 +1,131 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/browser/net/url_context.h"
+
+#include <memory>
+#include <string>
+
+#include "chrome/test/base/testing_profile.h"
+#include "content/public/test/browser_task_environment.h"
+#include "services/network/public/cpp/resource_request.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+
+using brave::BraveRequestInfo;
+
+namespace {
+
+const uint64_t kRequestIdentifier = 1;
+const size_t kLargeUploadSize = 4 * 1024 * 1024;
+
+// Returns a POST request whose body is made of |element_count| bytes elements
+// of |element_size| bytes each.
+network::ResourceRequest MakePostRequest(size_t element_size,
+                                         size_t element_count) {
+  network::ResourceRequest request;
+  request.method = "POST";
+  request.url = GURL("https://example.com/upload");
+  request.request_body = new network::ResourceRequestBody();
+  const std::string element(element_size, 'a');
+  for (size_t i = 0; i < element_count; ++i)
+    request.request_body->AppendBytes(element.data(), element.size());
+  return request;
+}
+
+}  // namespace
+
+class BraveRequestInfoTest : public testing::Test {
+ public:
+  BraveRequestInfoTest() = default;
+  ~BraveRequestInfoTest() override = default;
+
+  // Runs the three stages a request goes through, returning the context of
+  // the last one.
+  std::shared_ptr<BraveRequestInfo> RunStages(
+      const network::ResourceRequest& request,
+      std::shared_ptr<BraveRequestInfo>* first_ctx = nullptr) {
+    std::shared_ptr<BraveRequestInfo> ctx;
+    for (int stage = 0; stage < 3; ++stage) {
+      ctx = BraveRequestInfo::MakeCTX(request, 0, 0, kRequestIdentifier,
+                                      &profile_, ctx);
+      if (first_ctx && stage == 0)
+        *first_ctx = ctx;
+    }
+    return ctx;
+  }
+
+ protected:
+  content::BrowserTaskEnvironment task_environment_;
+  TestingProfile profile_;
+};
+
+TEST_F(BraveRequestInfoTest, ContextIsReusedAcrossStages) {
+  network::ResourceRequest request;
+  request.method = "GET";
+  request.url = GURL("https://example.com/");
+
+  std::shared_ptr<BraveRequestInfo> ctx = BraveRequestInfo::MakeCTX(
+      request, 0, 0, kRequestIdentifier, &profile_, nullptr);
+  ctx->blocked_by = brave::kAdBlocked;
+  ctx->mock_data_url = "data:text/plain,";
+  ctx->new_url_spec = "https://example.org/";
+  ctx->next_url_request_index = 3;
+  ctx->internal_redirect = true;
+  ctx->redirect_source = GURL("https://example.net/");
+
+  std::shared_ptr<BraveRequestInfo> next_ctx = BraveRequestInfo::MakeCTX(
+      request, 0, 0, kRequestIdentifier, &profile_, ctx);
+  EXPECT_EQ(ctx.get(), next_ctx.get());
+  // What the previous stage produced is gone...
+  EXPECT_EQ(brave::kNotBlocked, next_ctx->blocked_by);
+  EXPECT_FALSE(next_ctx->ShouldMockRequest());
+  EXPECT_TRUE(next_ctx->new_url_spec.empty());
+  EXPECT_EQ(0u, next_ctx->next_url_request_index);
+  // ...while the redirect state of the request is kept.
+  EXPECT_TRUE(next_ctx->internal_redirect);
+  EXPECT_EQ(GURL("https://example.net/"), next_ctx->redirect_source);
+
+  // Another request gets its own context.
+  std::shared_ptr<BraveRequestInfo> other_ctx = BraveRequestInfo::MakeCTX(
+      request, 0, 0, kRequestIdentifier + 1, &profile_, ctx);
+  EXPECT_NE(ctx.get(), other_ctx.get());
+}
+
+TEST_F(BraveRequestInfoTest, UploadDataIsSharedWithTheRequest) {
+  network::ResourceRequest request = MakePostRequest(16, 1);
+  std::shared_ptr<BraveRequestInfo> ctx = RunStages(request);
+
+  const network::DataElement& element =
+      request.request_body->elements()->front();
+  base::StringPiece upload_data = ctx->GetUploadData();
+  EXPECT_EQ(std::string(16, 'a'), upload_data);
+  EXPECT_EQ(element.bytes(), upload_data.data());
+}
+
+TEST_F(BraveRequestInfoTest, UploadDataJoinsElements) {
+  network::ResourceRequest request = MakePostRequest(8, 3);
+  std::shared_ptr<BraveRequestInfo> ctx = RunStages(request);
+  EXPECT_EQ(std::string(24, 'a'), ctx->GetUploadData());
+
+  request.request_body = nullptr;
+  ctx = BraveRequestInfo::MakeCTX(request, 0, 0, kRequestIdentifier,
+                                  &profile_, ctx);
+  EXPECT_TRUE(ctx->GetUploadData().empty());
+}
+
+// A large POST request goes through its three stages with a single context
+// and without copying its body.
+TEST_F(BraveRequestInfoTest, LargeUploadIsNotCopied) {
+  network::ResourceRequest request = MakePostRequest(kLargeUploadSize, 1);
+  const char* body_bytes = request.request_body->elements()->front().bytes();
+
+  std::shared_ptr<BraveRequestInfo> first_ctx;
+  std::shared_ptr<BraveRequestInfo> ctx = RunStages(request, &first_ctx);
+  EXPECT_EQ(first_ctx.get(), ctx.get());
+  base::StringPiece upload_data = ctx->GetUploadData();
+  EXPECT_EQ(kLargeUploadSize, upload_data.size());
+  EXPECT_EQ(body_bytes, upload_data.data());
+}
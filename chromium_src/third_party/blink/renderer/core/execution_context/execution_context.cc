@@ -7,6 +7,8 @@
 
 #include "base/command_line.h"
 #include "base/strings/string_number_conversions.h"
+#include "brave/third_party/blink/renderer/brave_audio_farbling.h"
+#include "brave/third_party/blink/renderer/brave_canvas_farbling.h"
 #include "brave/third_party/blink/renderer/brave_farbling_constants.h"
 #include "crypto/hmac.h"
 #include "third_party/blink/public/platform/web_content_settings_client.h"
@@ -19,47 +21,20 @@
 #include "third_party/blink/renderer/platform/graphics/static_bitmap_image.h"
 #include "third_party/blink/renderer/platform/graphics/unaccelerated_static_bitmap_image.h"
 #include "third_party/blink/renderer/platform/heap/handle.h"
+#include "third_party/blink/renderer/platform/instrumentation/memory_pressure_listener.h"
 #include "third_party/blink/renderer/platform/network/network_utils.h"
 #include "third_party/blink/renderer/platform/supplementable.h"
 #include "third_party/blink/renderer/platform/wtf/text/string_builder.h"
-
-namespace {
-
-const uint64_t zero = 0;
-
-inline uint64_t lfsr_next(uint64_t v) {
-  return ((v >> 1) | (((v << 62) ^ (v << 61)) & (~(~zero << 63) << 62)));
-}
-
-float Identity(float value, size_t index) {
-  return value;
-}
-
-float ConstantMultiplier(double fudge_factor, float value, size_t index) {
-  return value * fudge_factor;
-}
-
-float PseudoRandomSequence(uint64_t seed, float value, size_t index) {
-  static uint64_t v;
-  const double maxUInt64AsDouble = UINT64_MAX;
-  if (index == 0) {
-    // start of loop, reset to initial seed which was passed in and is based on
-    // the domain key
-    v = seed;
-  }
-  // get next value in PRNG sequence
-  v = lfsr_next(v);
-  // return pseudo-random float between 0 and 0.1
-  return (v / maxUInt64AsDouble) / 10;
-}
-
-}  // namespace
+#include "third_party/blink/renderer/platform/wtf/wtf.h"
 
 namespace brave {
 
 const char kBraveSessionToken[] = "brave_session_token";
 const char BraveSessionCache::kSupplementName[] = "BraveSessionCache";
 const int kFarbledUserAgentMaxExtraSpaces = 5;
+// pixel bytes of perturbed canvases kept per context, enough for one 720p
+// canvas or many small ones
+const size_t kPerturbedCanvasCacheBytes = 4 * 1024 * 1024;
 
 // acceptable letters for generating random strings
 const char kLettersForRandomStrings[] =
@@ -86,7 +61,12 @@ blink::WebContentSettingsClient* GetContentSettingsClientFor(
 }
 
 BraveSessionCache::BraveSessionCache(ExecutionContext& context)
-    : Supplement<ExecutionContext>(context) {
+    : Supplement<ExecutionContext>(context),
+      perturbed_canvases_(kPerturbedCanvasCacheBytes) {
+  // Listeners are only notified on the main thread. Worker contexts keep
+  // their canvases until they go away.
+  if (WTF::IsMainThread())
+    blink::MemoryPressureListenerRegistry::Instance().RegisterClient(this);
   farbling_enabled_ = false;
   scoped_refptr<const blink::SecurityOrigin> origin;
   if (auto* window = blink::DynamicTo<blink::LocalDOMWindow>(context)) {
@@ -120,6 +100,16 @@ BraveSessionCache::BraveSessionCache(ExecutionContext& context)
   farbling_enabled_ = true;
 }
 
+void BraveSessionCache::OnMemoryPressure(
+    base::MemoryPressureListener::MemoryPressureLevel level) {
+  perturbed_canvases_.Clear();
+}
+
+void BraveSessionCache::Trace(blink::Visitor* visitor) const {
+  Supplement<ExecutionContext>::Trace(visitor);
+  blink::MemoryPressureListener::Trace(visitor);
+}
+
 BraveSessionCache& BraveSessionCache::From(ExecutionContext& context) {
   BraveSessionCache* cache =
       Supplement<ExecutionContext>::From<BraveSessionCache>(context);
@@ -130,7 +120,7 @@ BraveSessionCache& BraveSessionCache::From(ExecutionContext& context) {
   return *cache;
 }
 
-AudioFarblingCallback BraveSessionCache::GetAudioFarblingCallback(
+AudioFarblingHelper BraveSessionCache::GetAudioFarblingHelper(
     blink::WebContentSettingsClient* settings) {
   if (farbling_enabled_ && settings) {
     switch (settings->GetBraveFarblingLevel()) {
@@ -143,15 +133,15 @@ AudioFarblingCallback BraveSessionCache::GetAudioFarblingCallback(
         double fudge_factor = 0.99 + ((*fudge / maxUInt64AsDouble) / 100);
         VLOG(1) << "audio fudge factor (based on session token) = "
                 << fudge_factor;
-        return base::BindRepeating(&ConstantMultiplier, fudge_factor);
+        return AudioFarblingHelper::CreateBalanced(fudge_factor);
       }
       case BraveFarblingLevel::MAXIMUM: {
         uint64_t seed = *reinterpret_cast<uint64_t*>(domain_key_);
-        return base::BindRepeating(&PseudoRandomSequence, seed);
+        return AudioFarblingHelper::CreateMaximum(seed);
       }
     }
   }
-  return base::BindRepeating(&Identity);
+  return AudioFarblingHelper();
 }
 
 scoped_refptr<blink::StaticBitmapImage> BraveSessionCache::PerturbPixels(
@@ -184,43 +174,29 @@ BraveSessionCache::PerturbPixelsInternal(
   std::unique_ptr<blink::ImageDataBuffer> data_buffer =
       blink::ImageDataBuffer::Create(image_bitmap);
   uint8_t* pixels = const_cast<uint8_t*>(data_buffer->Pixels());
-  // This needs to be type size_t because we pass it to base::StringPiece
-  // later for content hashing. This is safe because the maximum canvas
-  // dimensions are less than SIZE_T_MAX. (Width and height are each
-  // limited to 32,767 pixels.)
+  // This is safe because the maximum canvas dimensions are less than
+  // SIZE_T_MAX. (Width and height are each limited to 32,767 pixels.)
   const size_t pixel_count = data_buffer->Width() * data_buffer->Height();
   // choose which channel (R, G, or B) to perturb
   const uint8_t* first_byte = reinterpret_cast<const uint8_t*>(domain_key_);
   uint8_t channel = *first_byte % 3;
-  // calculate initial seed to find first pixel to perturb, based on session
-  // key, domain key, and canvas contents
-  crypto::HMAC h(crypto::HMAC::SHA256);
   uint64_t session_plus_domain_key =
       session_key_ ^ *reinterpret_cast<uint64_t*>(domain_key_);
-  CHECK(h.Init(reinterpret_cast<const unsigned char*>(&session_plus_domain_key),
-               sizeof session_plus_domain_key));
-  uint8_t canvas_key[32];
-  CHECK(h.Sign(
-      base::StringPiece(reinterpret_cast<const char*>(pixels), pixel_count),
-      canvas_key, sizeof canvas_key));
-  uint64_t v = *reinterpret_cast<uint64_t*>(canvas_key);
-  uint64_t pixel_index;
-  // iterate through 32-byte canvas key and use each bit to determine how to
-  // perturb the current pixel
-  for (int i = 0; i < 32; i++) {
-    uint8_t bit = canvas_key[i];
-    for (int j = 8; j >= 0; j--) {
-      pixel_index = 4 * (v % pixel_count) + channel;
-      pixels[pixel_index] = pixels[pixel_index] ^ (bit & 0x1);
-      bit = bit >> 1;
-      // find next pixel to perturb
-      v = lfsr_next(v);
-    }
-  }
+  // identical readbacks get the same perturbation, so reuse the last results
+  const uint64_t digest_key[2] = {
+      session_plus_domain_key, *reinterpret_cast<uint64_t*>(domain_key_ + 8)};
+  const CanvasDigest digest = {
+      ComputeCanvasDigest(digest_key, pixels, 4 * pixel_count),
+      data_buffer->Width(), data_buffer->Height()};
+  if (const auto* cached = perturbed_canvases_.Get(digest))
+    return *cached;
+  PerturbCanvasPixels(pixels, pixel_count, channel, session_plus_domain_key,
+                      digest.hash);
   // convert back to a StaticBitmapImage to return to the caller
   scoped_refptr<blink::StaticBitmapImage> perturbed_bitmap =
       blink::UnacceleratedStaticBitmapImage::Create(
           data_buffer->RetainedImage());
+  perturbed_canvases_.Put(digest, perturbed_bitmap, 4 * pixel_count);
   return perturbed_bitmap;
 }
 
@@ -10,7 +10,9 @@
 
 #include <random>
 
-#include "base/callback.h"
+#include "brave/third_party/blink/renderer/brave_audio_farbling.h"
+#include "brave/third_party/blink/renderer/brave_canvas_farbling.h"
+#include "third_party/blink/renderer/platform/instrumentation/memory_pressure_listener.h"
 
 namespace blink {
 class StaticBitmapImage;
@@ -27,14 +29,13 @@ using blink::TraceTrait;
 
 namespace brave {
 
-typedef base::RepeatingCallback<float(float, size_t)> AudioFarblingCallback;
-
 CORE_EXPORT blink::WebContentSettingsClient* GetContentSettingsClientFor(
     ExecutionContext* context);
 
 class CORE_EXPORT BraveSessionCache final
     : public GarbageCollected<BraveSessionCache>,
-      public Supplement<ExecutionContext> {
+      public Supplement<ExecutionContext>,
+      public blink::MemoryPressureListener {
  public:
   static const char kSupplementName[];
 
@@ -43,7 +44,7 @@ class CORE_EXPORT BraveSessionCache final
 
   static BraveSessionCache& From(ExecutionContext&);
 
-  AudioFarblingCallback GetAudioFarblingCallback(
+  AudioFarblingHelper GetAudioFarblingHelper(
       blink::WebContentSettingsClient* settings);
   scoped_refptr<blink::StaticBitmapImage> PerturbPixels(
       blink::WebContentSettingsClient* settings,
@@ -52,10 +53,18 @@ class CORE_EXPORT BraveSessionCache final
   WTF::String FarbledUserAgent(WTF::String real_user_agent);
   std::mt19937_64 MakePseudoRandomGenerator();
 
+  // blink::MemoryPressureListener:
+  void OnMemoryPressure(
+      base::MemoryPressureListener::MemoryPressureLevel level) override;
+
+  void Trace(blink::Visitor*) const override;
+
  private:
   bool farbling_enabled_;
   uint64_t session_key_;
   uint8_t domain_key_[32];
+  PerturbedCanvasCache<scoped_refptr<blink::StaticBitmapImage>>
+      perturbed_canvases_;
 
   scoped_refptr<blink::StaticBitmapImage> PerturbPixelsInternal(
       scoped_refptr<blink::StaticBitmapImage> image_bitmap);
@@ -25,4 +25,9 @@ const base::Feature kBraveRewards{"BraveRewards",
 const base::Feature kGlobalPrivacyControl{"GlobalPrivacyControl",
                                           base::FEATURE_DISABLED_BY_DEFAULT};
 
+// Lets first-party requests from tabs with shields down skip the
+// OnBeforeURLRequest handlers when none of them can act on the request.
+const base::Feature kBraveRequestHandlerFastPath{
+    "BraveRequestHandlerFastPath", base::FEATURE_ENABLED_BY_DEFAULT};
+
 }  // namespace features
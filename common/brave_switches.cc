@@ -50,4 +50,8 @@ const char kComponentUpdateIntervalInSec[] = "component-update-interval-in-sec";
 
 // Disables DOH using a runtime flag mainly for network audit
 const char kDisableDnsOverHttps[] = "disable-doh";
+
+// Periodically logs where the slowest recent requests spent their time in the
+// network hooks.
+const char kDumpSlowRequests[] = "dump-slow-requests";
 }  // namespace switches
@@ -36,6 +36,8 @@ extern const char kComponentUpdateIntervalInSec[];
 
 extern const char kDisableDnsOverHttps[];
 
+extern const char kDumpSlowRequests[];
+
 }  // namespace switches
 
 #endif  // BRAVE_COMMON_BRAVE_SWITCHES_H_
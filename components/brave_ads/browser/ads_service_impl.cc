@@ -545,6 +545,28 @@ void AdsServiceImpl::Shutdown() {
 
   idle_poll_timer_.Stop();
 
+  if (!bat_ads_.is_bound() || !bat_ads_service_.is_connected()) {
+    Disconnect();
+    return;
+  }
+
+  // Ads state changes are written in batches and are saved through the ads
+  // client, so wait for any pending changes to be written before
+  // disconnecting, including when the browser is shutting down
+  bat_ads_->CommitPendingWrites(base::BindOnce(
+      &AdsServiceImpl::OnCommitPendingWrites, AsWeakPtr()));
+}
+
+void AdsServiceImpl::OnCommitPendingWrites(
+    const int32_t result) {
+  if (result != ads::Result::SUCCESS) {
+    VLOG(0) << "Failed to commit pending ads state";
+  }
+
+  Disconnect();
+}
+
+void AdsServiceImpl::Disconnect() {
   bat_ads_.reset();
   bat_ads_client_receiver_.reset();
   bat_ads_service_.reset();
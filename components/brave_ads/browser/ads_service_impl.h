@@ -189,6 +189,10 @@ class AdsServiceImpl : public AdsService,
   void OnInitialize(
       const int32_t result);
 
+  void OnCommitPendingWrites(
+      const int32_t result);
+  void Disconnect();
+
   void ShutdownBatAds();
   void OnShutdownBatAds(
       const int32_t result);
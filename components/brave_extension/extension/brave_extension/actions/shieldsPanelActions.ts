@@ -138,10 +138,11 @@ export const shieldsReady: actions.ShieldsReady = () => {
   }
 }
 
-export const generateClassIdStylesheet = (tabId: number, classes: string[], ids: string[]) => {
+export const generateClassIdStylesheet = (tabId: number, frameId: number, classes: string[], ids: string[]) => {
   return {
     type: types.GENERATE_CLASS_ID_STYLESHEET,
     tabId,
+    frameId,
     classes,
     ids
   }
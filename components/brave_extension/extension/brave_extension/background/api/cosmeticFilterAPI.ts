@@ -18,8 +18,9 @@ const informTabOfCosmeticRulesToConsider = (tabId: number, selectors: string[])
 }
 
 // Fires when content-script calls hiddenClassIdSelectors
-export const injectClassIdStylesheet = (tabId: number, classes: string[], ids: string[], exceptions: string[], hide1pContent: boolean) => {
-  chrome.braveShields.hiddenClassIdSelectors(classes, ids, exceptions, (selectors, forceHideSelectors) => {
+export const injectClassIdStylesheet = (tabId: number, frameId: number, classes: string[], ids: string[], exceptions: string[], hide1pContent: boolean) => {
+  // The browser skips classes and ids whose selectors this frame already got.
+  chrome.braveShields.hiddenClassIdSelectors(classes, ids, exceptions, tabId, frameId, (selectors, forceHideSelectors) => {
     if (hide1pContent) {
       forceHideSelectors.push(...selectors)
     } else {
@@ -40,7 +41,9 @@ export const injectClassIdStylesheet = (tabId: number, classes: string[], ids: s
 
 // Fires on content-script loaded
 export const applyAdblockCosmeticFilters = (tabId: number, frameId: number, url: string, hide1pContent: boolean) => {
-  chrome.braveShields.urlCosmeticResources(url, async (resources) => {
+  // Also restarts the browser's record of the classes and ids already sent
+  // to this frame, since the new content script has none of them applied.
+  chrome.braveShields.urlCosmeticResources(url, tabId, frameId, async (resources) => {
     if (chrome.runtime.lastError) {
       console.warn('Unable to get cosmetic filter data for the current host', chrome.runtime.lastError)
       return
@@ -59,7 +59,11 @@ chrome.runtime.onMessage.addListener((msg, sender, sendResponse) => {
       if (tabId === undefined) {
         break
       }
-      shieldsPanelActions.generateClassIdStylesheet(tabId, msg.classes, msg.ids)
+      const frameId = sender.frameId
+      if (frameId === undefined) {
+        break
+      }
+      shieldsPanelActions.generateClassIdStylesheet(tabId, frameId, msg.classes, msg.ids)
       break
     }
     case 'contentScriptsLoaded': {
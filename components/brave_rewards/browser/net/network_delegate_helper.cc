@@ -8,6 +8,7 @@
 #include <memory>
 #include <string>
 
+#include "base/strings/string_piece.h"
 #include "base/task/post_task.h"
 #include "brave/components/brave_rewards/browser/rewards_service.h"
 #include "brave/browser/brave_rewards/rewards_service_factory.h"
@@ -43,7 +44,7 @@ content::WebContents* GetWebContents(
 }
 
 void DispatchOnUI(
-    const std::string post_data,
+    base::StringPiece post_data,
     const GURL url,
     const GURL first_party_url,
     const std::string referrer,
@@ -66,7 +67,7 @@ void DispatchOnUI(
   if (rewards_service)
     rewards_service->OnPostData(tab_helper->session_id(),
                                 url, first_party_url,
-                                GURL(referrer), post_data);
+                                GURL(referrer), post_data.as_string());
 }
 
 }  // namespace
@@ -77,8 +78,10 @@ int OnBeforeURLRequest(
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
 
   if (IsMediaLink(ctx->request_url, ctx->tab_origin, ctx->referrer)) {
-    if (!ctx->upload_data.empty()) {
-      DispatchOnUI(ctx->upload_data,
+    // Only media links need the request body, so it is not read otherwise.
+    base::StringPiece upload_data = ctx->GetUploadData();
+    if (!upload_data.empty()) {
+      DispatchOnUI(upload_data,
                    ctx->request_url,
                    ctx->tab_url,
                    ctx->referrer.spec(),
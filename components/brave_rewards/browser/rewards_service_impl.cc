@@ -1385,6 +1385,7 @@ bool RewardsServiceImpl::ResetOnFilesTaskRunner() {
     ledger_state_path_,
     publisher_state_path_,
     publisher_info_db_path_,
+    ledger::LedgerDatabase::GetPrefixListPath(publisher_info_db_path_),
     diagnostic_log_path_,
     publisher_list_path_,
   };
@@ -11,16 +11,22 @@
 #include <vector>
 
 #include "base/bind.h"
+#include "base/bind_helpers.h"
+#include "base/feature_list.h"
 #include "base/files/file_path.h"
-#include "base/json/json_reader.h"
 #include "base/macros.h"
 #include "base/memory/ptr_util.h"
+#include "base/memory/ref_counted.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/synchronization/lock.h"
 #include "base/task/post_task.h"
+#include "base/time/time.h"
 #include "brave/browser/net/url_context.h"
 #include "brave/common/pref_names.h"
 #include "brave/components/brave_component_updater/browser/dat_file_util.h"
+#include "brave/components/brave_shields/browser/ad_block_decision_cache.h"
 #include "brave/components/brave_shields/common/brave_shield_constants.h"
+#include "brave/components/brave_shields/common/features.h"
 #include "brave/vendor/adblock_rust_ffi/src/wrapper.hpp"
 #include "components/prefs/pref_service.h"
 #include "content/public/browser/browser_task_traits.h"
@@ -34,6 +40,15 @@ using namespace net::registry_controlled_domains;  // NOLINT
 
 namespace {
 
+const size_t kDecisionCacheMaxHosts = 32;
+const size_t kDecisionCacheMaxDecisionsPerHost = 512;
+
+// How long tag and resource changes are collected before the engine is
+// rebuilt for them with parallel matching, so that a burst of changes only
+// rebuilds it once.
+constexpr base::TimeDelta kEngineRebuildDelay =
+    base::TimeDelta::FromMilliseconds(100);
+
 std::string ResourceTypeToString(blink::mojom::ResourceType resource_type) {
   std::string filter_option = "";
   switch (resource_type) {
@@ -100,17 +115,170 @@ std::string ResourceTypeToString(blink::mojom::ResourceType resource_type) {
   return filter_option;
 }
 
+brave_shields::AdBlockMatchResult MatchRequest(
+    adblock::Engine* engine,
+    const GURL& url,
+    blink::mojom::ResourceType resource_type,
+    const std::string& tab_host) {
+  brave_shields::AdBlockMatchResult result;
+  // Determine third-party here so the library doesn't need to figure it
+  // out. CreateFromNormalizedTuple is needed because SameDomainOrHost needs
+  // a URL or origin and not a string to a host name.
+  bool is_third_party = !SameDomainOrHost(
+      url,
+      url::Origin::CreateFromNormalizedTuple("https", tab_host.c_str(), 80),
+      INCLUDE_PRIVATE_REGISTRIES);
+  // TODO(spinda): Remove explicit_cancel here when removed from
+  // adblock-rust.
+  bool explicit_cancel;
+  bool saved_from_exception;
+  if (engine->matches(url.spec(), url.host(), tab_host, is_third_party,
+                      ResourceTypeToString(resource_type), &explicit_cancel,
+                      &saved_from_exception, &result.mock_data_url)) {
+    // We'd only possibly match an exception filter if we're returning true.
+    result.should_start = false;
+    result.did_match_exception = false;
+  } else {
+    result.should_start = true;
+    result.did_match_exception = saved_from_exception;
+  }
+  return result;
+}
+
+std::unique_ptr<adblock::Engine> CreateEngineFromRules(
+    const std::string& rules) {
+  return std::make_unique<adblock::Engine>(rules);
+}
+
+// Reads the DAT file the first time an engine is built from it and keeps its
+// contents, so that rebuilding the engine for new tags or resources does not
+// go back to disk.
+class DATFileEngineSource
+    : public base::RefCountedThreadSafe<DATFileEngineSource> {
+ public:
+  explicit DATFileEngineSource(const base::FilePath& dat_file_path)
+      : dat_file_path_(dat_file_path) {}
+
+  std::unique_ptr<adblock::Engine> CreateEngine() {
+    base::AutoLock lock(lock_);
+    if (buffer_.empty()) {
+      brave_component_updater::GetDATFileData(dat_file_path_, &buffer_);
+      if (buffer_.empty()) {
+        LOG(ERROR) << "Could not obtain ad block data";
+        return nullptr;
+      }
+    }
+    auto engine = std::make_unique<adblock::Engine>();
+    if (!engine->deserialize(reinterpret_cast<char*>(&buffer_.front()),
+                             buffer_.size())) {
+      LOG(ERROR) << "Failed to deserialize ad block data";
+      return nullptr;
+    }
+    return engine;
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<DATFileEngineSource>;
+  ~DATFileEngineSource() = default;
+
+  const base::FilePath dat_file_path_;
+  // Engines may be built from the same source on several thread pool tasks.
+  base::Lock lock_;
+  brave_component_updater::DATFileDataBuffer buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(DATFileEngineSource);
+};
+
+// Runs on the thread pool, the new engine is not shared with anyone yet.
+std::unique_ptr<adblock::Engine> BuildEngine(
+    const brave_shields::AdBlockBaseService::EngineBuilder& builder,
+    const std::vector<std::string>& tags,
+    const std::string& resources) {
+  std::unique_ptr<adblock::Engine> engine = builder.Run();
+  if (!engine)
+    return nullptr;
+  for (const std::string& tag : tags)
+    engine->addTag(tag);
+  engine->addResources(resources);
+  return engine;
+}
+
+// Tearing down a large engine is not free either, so it is kept off the
+// adblock task runner too.
+void DeleteEngineSoon(std::unique_ptr<adblock::Engine> engine) {
+  if (!engine)
+    return;
+  base::PostTask(
+      FROM_HERE, {base::ThreadPool(), base::TaskPriority::BEST_EFFORT},
+      base::BindOnce(base::DoNothing::Once<std::unique_ptr<adblock::Engine>>(),
+                     std::move(engine)));
+}
+
 }  // namespace
 
 namespace brave_shields {
 
+AdBlockMatchRequest::AdBlockMatchRequest()
+    : resource_type(blink::mojom::ResourceType::kSubResource) {}
+
+AdBlockMatchRequest::AdBlockMatchRequest(
+    const GURL& url,
+    blink::mojom::ResourceType resource_type,
+    const std::string& tab_host)
+    : url(url), resource_type(resource_type), tab_host(tab_host) {}
+
+AdBlockMatchRequest::AdBlockMatchRequest(const AdBlockMatchRequest& other) =
+    default;
+
+AdBlockMatchRequest::AdBlockMatchRequest(AdBlockMatchRequest&& other) =
+    default;
+
+AdBlockMatchRequest& AdBlockMatchRequest::operator=(
+    const AdBlockMatchRequest& other) = default;
+
+AdBlockMatchRequest& AdBlockMatchRequest::operator=(
+    AdBlockMatchRequest&& other) = default;
+
+AdBlockMatchRequest::~AdBlockMatchRequest() = default;
+
+AdBlockMatchResult::AdBlockMatchResult() = default;
+
+AdBlockMatchResult::AdBlockMatchResult(const AdBlockMatchResult& other) =
+    default;
+
+AdBlockMatchResult::AdBlockMatchResult(AdBlockMatchResult&& other) = default;
+
+AdBlockMatchResult& AdBlockMatchResult::operator=(
+    const AdBlockMatchResult& other) = default;
+
+AdBlockMatchResult& AdBlockMatchResult::operator=(
+    AdBlockMatchResult&& other) = default;
+
+AdBlockMatchResult::~AdBlockMatchResult() = default;
+
+AdBlockEngineSnapshot::AdBlockEngineSnapshot(
+    std::unique_ptr<adblock::Engine> engine)
+    : engine_(std::move(engine)) {
+  DCHECK(engine_);
+}
+
+AdBlockEngineSnapshot::~AdBlockEngineSnapshot() {
+  DeleteEngineSoon(std::move(engine_));
+}
+
 AdBlockBaseService::AdBlockBaseService(BraveComponent::Delegate* delegate)
     : BaseBraveShieldsService(delegate),
-      ad_block_client_(new adblock::Engine()),
+      parallel_matching_(base::FeatureList::IsEnabled(
+          features::kBraveAdblockParallelMatching)),
+      ad_block_client_(base::MakeRefCounted<AdBlockEngineSnapshot>(
+          std::make_unique<adblock::Engine>())),
+      decision_cache_(
+          std::make_unique<AdBlockDecisionCache>(
+              kDecisionCacheMaxHosts, kDecisionCacheMaxDecisionsPerHost)),
       weak_factory_(this) {}
 
 AdBlockBaseService::~AdBlockBaseService() {
-  GetTaskRunner()->DeleteSoon(FROM_HERE, ad_block_client_.release());
+  GetTaskRunner()->DeleteSoon(FROM_HERE, std::move(decision_cache_));
 }
 
 bool AdBlockBaseService::ShouldStartRequest(
@@ -121,36 +289,75 @@ bool AdBlockBaseService::ShouldStartRequest(
     std::string* mock_data_url) {
   DCHECK(GetTaskRunner()->RunsTasksInCurrentSequence());
 
-  // Determine third-party here so the library doesn't need to figure it out.
-  // CreateFromNormalizedTuple is needed because SameDomainOrHost needs
-  // a URL or origin and not a string to a host name.
-  bool is_third_party = !SameDomainOrHost(
-      url,
-      url::Origin::CreateFromNormalizedTuple("https", tab_host.c_str(), 80),
-      INCLUDE_PRIVATE_REGISTRIES);
-  // TODO(spinda): Remove explicit_cancel here when removed from adblock-rust.
-  bool explicit_cancel;
-  bool saved_from_exception;
-  if (ad_block_client_->matches(
-          url.spec(), url.host(), tab_host, is_third_party,
-          ResourceTypeToString(resource_type), &explicit_cancel,
-          &saved_from_exception, mock_data_url)) {
-    // We'd only possibly match an exception filter if we're returning true.
-    if (did_match_exception) {
-      *did_match_exception = false;
-    }
-    // LOG(ERROR) << "AdBlockBaseService::ShouldStartRequest(), host: "
-    //  << tab_host
-    //  << ", resource type: " << resource_type
-    //  << ", url.spec(): " << url.spec();
-    return false;
+  AdBlockMatchResult result;
+  if (!decision_cache_->Get(tab_host, url, resource_type, &result)) {
+    result = MatchRequest(ad_block_client_->engine(), url, resource_type,
+                          tab_host);
+    decision_cache_->Put(tab_host, url, resource_type, result);
   }
 
+  if (mock_data_url && !result.mock_data_url.empty()) {
+    *mock_data_url = result.mock_data_url;
+  }
   if (did_match_exception) {
-    *did_match_exception = saved_from_exception;
+    *did_match_exception = result.did_match_exception;
   }
 
-  return true;
+  return result.should_start;
+}
+
+std::vector<AdBlockMatchResult> AdBlockBaseService::ShouldStartRequests(
+    const std::vector<AdBlockMatchRequest>& requests) {
+  std::vector<AdBlockMatchResult> results(requests.size());
+  MatchRequests(requests, &results);
+  return results;
+}
+
+void AdBlockBaseService::MatchRequests(
+    const std::vector<AdBlockMatchRequest>& requests,
+    std::vector<AdBlockMatchResult>* results) {
+  DCHECK_EQ(requests.size(), results->size());
+  if (!GetTaskRunner()->RunsTasksInCurrentSequence()) {
+    DCHECK(parallel_matching_);
+    MatchRequestsAgainst(*GetEngineSnapshot(), requests, results);
+    return;
+  }
+
+  for (size_t i = 0; i < requests.size(); ++i) {
+    AdBlockMatchResult& result = (*results)[i];
+    if (result.IsDecided())
+      continue;
+    result.should_start = AdBlockBaseService::ShouldStartRequest(
+        requests[i].url, requests[i].resource_type, requests[i].tab_host,
+        &result.did_match_exception, &result.mock_data_url);
+  }
+}
+
+scoped_refptr<AdBlockEngineSnapshot> AdBlockBaseService::GetEngineSnapshot() {
+  base::AutoLock lock(ad_block_client_lock_);
+  return ad_block_client_;
+}
+
+// static
+void AdBlockBaseService::MatchRequestsAgainst(
+    const AdBlockEngineSnapshot& snapshot,
+    const std::vector<AdBlockMatchRequest>& requests,
+    std::vector<AdBlockMatchResult>* results) {
+  DCHECK_EQ(requests.size(), results->size());
+  for (size_t i = 0; i < requests.size(); ++i) {
+    AdBlockMatchResult& result = (*results)[i];
+    if (result.IsDecided())
+      continue;
+    // Merged like ShouldStartRequest() fills its out parameters, so that a
+    // redirect found by an earlier engine is kept.
+    AdBlockMatchResult match =
+        MatchRequest(snapshot.engine(), requests[i].url,
+                     requests[i].resource_type, requests[i].tab_host);
+    result.should_start = match.should_start;
+    result.did_match_exception = match.did_match_exception;
+    if (!match.mock_data_url.empty())
+      result.mock_data_url = std::move(match.mock_data_url);
+  }
 }
 
 void AdBlockBaseService::EnableTag(const std::string& tag, bool enabled) {
@@ -161,17 +368,24 @@ void AdBlockBaseService::EnableTag(const std::string& tag, bool enabled) {
     return;
   }
 
+  ClearDecisionCache();
   if (enabled) {
-    ad_block_client_->addTag(tag);
+    if (!parallel_matching_)
+      ad_block_client_->engine()->addTag(tag);
     tags_.push_back(tag);
   } else {
-    ad_block_client_->removeTag(tag);
+    if (!parallel_matching_)
+      ad_block_client_->engine()->removeTag(tag);
     std::vector<std::string>::iterator it =
         std::find(tags_.begin(), tags_.end(), tag);
     if (it != tags_.end()) {
       tags_.erase(it);
     }
   }
+  // Snapshots handed out to the matching sequences must not change under
+  // them, so a new engine is built with the updated tags instead.
+  if (parallel_matching_)
+    RebuildAdBlockClientSoon();
 }
 
 void AdBlockBaseService::AddResources(const std::string& resources) {
@@ -182,68 +396,128 @@ void AdBlockBaseService::AddResources(const std::string& resources) {
     return;
   }
 
-  ad_block_client_->addResources(resources);
+  ClearDecisionCache();
   resources_ = resources;
+  if (!parallel_matching_)
+    ad_block_client_->engine()->addResources(resources);
+  else
+    RebuildAdBlockClientSoon();
 }
 
 bool AdBlockBaseService::TagExists(const std::string& tag) {
   return std::find(tags_.begin(), tags_.end(), tag) != tags_.end();
 }
 
-base::Optional<base::Value> AdBlockBaseService::UrlCosmeticResources(
+base::Optional<CosmeticResources> AdBlockBaseService::UrlCosmeticResources(
         const std::string& url) {
   DCHECK(GetTaskRunner()->RunsTasksInCurrentSequence());
-  return base::JSONReader::Read(ad_block_client_->urlCosmeticResources(url));
+  return CosmeticResources::FromJSON(
+      ad_block_client_->engine()->urlCosmeticResources(url));
 }
 
-base::Optional<base::Value> AdBlockBaseService::HiddenClassIdSelectors(
+std::vector<std::string> AdBlockBaseService::HiddenClassIdSelectors(
         const std::vector<std::string>& classes,
         const std::vector<std::string>& ids,
         const std::vector<std::string>& exceptions) {
   DCHECK(GetTaskRunner()->RunsTasksInCurrentSequence());
-  return base::JSONReader::Read(
-      ad_block_client_->hiddenClassIdSelectors(classes, ids, exceptions));
+  return HiddenClassIdSelectorsFromJSON(
+      ad_block_client_->engine()->hiddenClassIdSelectors(classes, ids,
+                                                         exceptions));
 }
 
 void AdBlockBaseService::GetDATFileData(const base::FilePath& dat_file_path) {
+  BuildAdBlockClient(base::BindRepeating(
+      &DATFileEngineSource::CreateEngine,
+      base::MakeRefCounted<DATFileEngineSource>(dat_file_path)));
+}
+
+void AdBlockBaseService::BuildAdBlockClient(EngineBuilder builder) {
+  if (!GetTaskRunner()->RunsTasksInCurrentSequence()) {
+    GetTaskRunner()->PostTask(
+        FROM_HERE, base::BindOnce(&AdBlockBaseService::BuildAdBlockClient,
+                                  base::Unretained(this), std::move(builder)));
+    return;
+  }
+
+  // Only parallel matching rebuilds the engine, which otherwise would keep
+  // the source of a DAT file engine in memory for nothing.
+  if (parallel_matching_)
+    engine_builder_ = builder;
+  build_in_progress_ = true;
+  // The tags and resources are snapshotted so that changes made while the
+  // engine is being built can be reconciled when it is published.
   base::PostTaskAndReplyWithResult(
       FROM_HERE, {base::ThreadPool(), base::MayBlock()},
-      base::BindOnce(&brave_component_updater::LoadDATFileData<adblock::Engine>,
-                     dat_file_path),
-      base::BindOnce(&AdBlockBaseService::OnGetDATFileData,
-                     weak_factory_.GetWeakPtr()));
+      base::BindOnce(&BuildEngine, std::move(builder), tags_, resources_),
+      base::BindOnce(&AdBlockBaseService::PublishAdBlockClient,
+                     weak_factory_.GetWeakPtr(), ++latest_build_id_, tags_,
+                     resources_));
+}
+
+void AdBlockBaseService::BuildAdBlockClientFromRules(const std::string& rules) {
+  BuildAdBlockClient(base::BindRepeating(&CreateEngineFromRules, rules));
 }
 
-void AdBlockBaseService::OnGetDATFileData(GetDATFileDataResult result) {
-  if (result.second.empty()) {
-    LOG(ERROR) << "Could not obtain ad block data";
+void AdBlockBaseService::RebuildAdBlockClientSoon() {
+  DCHECK(GetTaskRunner()->RunsTasksInCurrentSequence());
+  DCHECK(parallel_matching_);
+  if (!engine_builder_ || rebuild_pending_)
     return;
-  }
-  if (!result.first.get()) {
-    LOG(ERROR) << "Failed to deserialize ad block data";
+  rebuild_pending_ = true;
+  GetTaskRunner()->PostDelayedTask(
+      FROM_HERE,
+      base::BindOnce(&AdBlockBaseService::RebuildAdBlockClient,
+                     weak_factory_.GetWeakPtr()),
+      kEngineRebuildDelay);
+}
+
+void AdBlockBaseService::RebuildAdBlockClient() {
+  DCHECK(GetTaskRunner()->RunsTasksInCurrentSequence());
+  rebuild_pending_ = false;
+  // A build that is still running picks up the current tags and resources
+  // when it is published.
+  if (build_in_progress_)
     return;
-  }
-  GetTaskRunner()->PostTask(
-      FROM_HERE, base::BindOnce(&AdBlockBaseService::UpdateAdBlockClient,
-                                base::Unretained(this),
-                                std::move(result.first)));
+  BuildAdBlockClient(engine_builder_);
 }
 
-void AdBlockBaseService::UpdateAdBlockClient(
+void AdBlockBaseService::PublishAdBlockClient(
+    uint64_t build_id,
+    const std::vector<std::string>& built_tags,
+    const std::string& built_resources,
     std::unique_ptr<adblock::Engine> ad_block_client) {
   DCHECK(GetTaskRunner()->RunsTasksInCurrentSequence());
-  ad_block_client_ = std::move(ad_block_client);
-  AddKnownTagsToAdBlockInstance();
-  AddKnownResourcesToAdBlockInstance();
-}
+  if (build_id == latest_build_id_)
+    build_in_progress_ = false;
+  if (!ad_block_client || build_id != latest_build_id_) {
+    DeleteEngineSoon(std::move(ad_block_client));
+    return;
+  }
+
+  for (const std::string& tag : tags_) {
+    if (std::find(built_tags.begin(), built_tags.end(), tag) ==
+        built_tags.end()) {
+      ad_block_client->addTag(tag);
+    }
+  }
+  for (const std::string& tag : built_tags) {
+    if (!TagExists(tag))
+      ad_block_client->removeTag(tag);
+  }
+  if (resources_ != built_resources)
+    ad_block_client->addResources(resources_);
 
-void AdBlockBaseService::AddKnownTagsToAdBlockInstance() {
-  std::for_each(tags_.begin(), tags_.end(),
-                [&](const std::string tag) { ad_block_client_->addTag(tag); });
+  scoped_refptr<AdBlockEngineSnapshot> snapshot =
+      base::MakeRefCounted<AdBlockEngineSnapshot>(std::move(ad_block_client));
+  {
+    base::AutoLock lock(ad_block_client_lock_);
+    ad_block_client_.swap(snapshot);
+  }
+  ClearDecisionCache();
 }
 
-void AdBlockBaseService::AddKnownResourcesToAdBlockInstance() {
-  ad_block_client_->addResources(resources_);
+void AdBlockBaseService::ClearDecisionCache() {
+  decision_cache_->Clear();
 }
 
 bool AdBlockBaseService::Init() {
@@ -252,15 +526,20 @@ bool AdBlockBaseService::Init() {
 
 void AdBlockBaseService::ResetForTest(const std::string& rules,
                                       const std::string& resources) {
+  if (!GetTaskRunner()->RunsTasksInCurrentSequence()) {
+    GetTaskRunner()->PostTask(
+        FROM_HERE, base::BindOnce(&AdBlockBaseService::ResetForTest,
+                                  base::Unretained(this), rules, resources));
+    return;
+  }
+
   // This is temporary until adblock-rust supports incrementally adding
   // filter rules to an existing instance. At which point the hack below
   // will dissapear.
-  ad_block_client_.reset(new adblock::Engine(rules));
-  AddKnownTagsToAdBlockInstance();
   if (!resources.empty()) {
     resources_ = resources;
   }
-  AddKnownResourcesToAdBlockInstance();
+  BuildAdBlockClientFromRules(rules);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
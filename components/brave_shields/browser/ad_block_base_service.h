@@ -13,12 +13,15 @@
 #include <utility>
 #include <vector>
 
+#include "base/callback_forward.h"
 #include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
 #include "base/memory/weak_ptr.h"
 #include "base/sequence_checker.h"
+#include "base/synchronization/lock.h"
 #include "base/values.h"
 #include "brave/components/brave_shields/browser/base_brave_shields_service.h"
-#include "brave/components/brave_component_updater/browser/dat_file_util.h"
+#include "brave/components/brave_shields/browser/cosmetic_resources.h"
 #include "third_party/blink/public/mojom/loader/resource_load_info.mojom-shared.h"
 
 class AdBlockServiceTest;
@@ -30,12 +33,72 @@ class Engine;
 
 namespace brave_shields {
 
+class AdBlockDecisionCache;
+
+// A request to evaluate with AdBlockBaseService::ShouldStartRequests().
+struct AdBlockMatchRequest {
+  AdBlockMatchRequest();
+  AdBlockMatchRequest(const GURL& url,
+                      blink::mojom::ResourceType resource_type,
+                      const std::string& tab_host);
+  AdBlockMatchRequest(const AdBlockMatchRequest& other);
+  AdBlockMatchRequest(AdBlockMatchRequest&& other);
+  AdBlockMatchRequest& operator=(const AdBlockMatchRequest& other);
+  AdBlockMatchRequest& operator=(AdBlockMatchRequest&& other);
+  ~AdBlockMatchRequest();
+
+  GURL url;
+  blink::mojom::ResourceType resource_type;
+  std::string tab_host;
+};
+
+// The outcome of evaluating an AdBlockMatchRequest, mirroring the out
+// parameters of ShouldStartRequest().
+struct AdBlockMatchResult {
+  AdBlockMatchResult();
+  AdBlockMatchResult(const AdBlockMatchResult& other);
+  AdBlockMatchResult(AdBlockMatchResult&& other);
+  AdBlockMatchResult& operator=(const AdBlockMatchResult& other);
+  AdBlockMatchResult& operator=(AdBlockMatchResult&& other);
+  ~AdBlockMatchResult();
+
+  // Once a request is blocked or saved by an exception filter no further
+  // engine needs to look at it.
+  bool IsDecided() const { return !should_start || did_match_exception; }
+
+  bool should_start = true;
+  bool did_match_exception = false;
+  std::string mock_data_url;
+};
+
+// A published engine. With parallel matching it is shared read-only with
+// the matching sequences, and is no longer modified once it has been handed
+// out.
+class AdBlockEngineSnapshot
+    : public base::RefCountedThreadSafe<AdBlockEngineSnapshot> {
+ public:
+  explicit AdBlockEngineSnapshot(std::unique_ptr<adblock::Engine> engine);
+
+  adblock::Engine* engine() const { return engine_.get(); }
+
+ private:
+  friend class base::RefCountedThreadSafe<AdBlockEngineSnapshot>;
+  ~AdBlockEngineSnapshot();
+
+  std::unique_ptr<adblock::Engine> engine_;
+
+  DISALLOW_COPY_AND_ASSIGN(AdBlockEngineSnapshot);
+};
+
 // The base class of the brave shields service in charge of ad-block
 // checking and init.
 class AdBlockBaseService : public BaseBraveShieldsService {
  public:
-  using GetDATFileDataResult =
-      brave_component_updater::LoadDATFileDataResult<adblock::Engine>;
+  // Creates a new engine, or returns nullptr if it could not be created. Kept
+  // around to rebuild the engine when its tags or resources change while
+  // parallel matching is enabled.
+  using EngineBuilder =
+      base::RepeatingCallback<std::unique_ptr<adblock::Engine>()>;
 
   explicit AdBlockBaseService(BraveComponent::Delegate* delegate);
   ~AdBlockBaseService() override;
@@ -45,13 +108,33 @@ class AdBlockBaseService : public BaseBraveShieldsService {
                           const std::string& tab_host,
                           bool* did_match_exception,
                           std::string* mock_data_url) override;
+  // Evaluates all |requests| in one go, returning one result per request in
+  // the same order. Must be called on the adblock task runner, or on one of
+  // the matching sequences when parallel matching is enabled; callers on
+  // other sequences should post a single task for a whole batch instead of
+  // one task per request.
+  virtual std::vector<AdBlockMatchResult> ShouldStartRequests(
+      const std::vector<AdBlockMatchRequest>& requests);
+  // Evaluates the requests that are still undecided in |results| against
+  // this service's engine only. |results| must have one entry per request.
+  // Off the adblock task runner the current engine snapshot is matched
+  // directly, without going through the decision cache.
+  void MatchRequests(const std::vector<AdBlockMatchRequest>& requests,
+                     std::vector<AdBlockMatchResult>* results);
+  // Returns the engine currently in use. Can be called from any sequence.
+  scoped_refptr<AdBlockEngineSnapshot> GetEngineSnapshot();
+  // Matches the undecided requests in |results| against |snapshot|.
+  static void MatchRequestsAgainst(
+      const AdBlockEngineSnapshot& snapshot,
+      const std::vector<AdBlockMatchRequest>& requests,
+      std::vector<AdBlockMatchResult>* results);
   void AddResources(const std::string& resources);
   void EnableTag(const std::string& tag, bool enabled);
   bool TagExists(const std::string& tag);
 
-  base::Optional<base::Value> UrlCosmeticResources(
+  base::Optional<CosmeticResources> UrlCosmeticResources(
           const std::string& url);
-  base::Optional<base::Value> HiddenClassIdSelectors(
+  std::vector<std::string> HiddenClassIdSelectors(
           const std::vector<std::string>& classes,
           const std::vector<std::string>& ids,
           const std::vector<std::string>& exceptions);
@@ -61,20 +144,46 @@ class AdBlockBaseService : public BaseBraveShieldsService {
   bool Init() override;
 
   void GetDATFileData(const base::FilePath& dat_file_path);
-  void AddKnownTagsToAdBlockInstance();
-  void AddKnownResourcesToAdBlockInstance();
+  // Runs |builder| and applies the known tags and resources to the new engine
+  // on the thread pool, then swaps it in on the adblock task runner. Requests
+  // keep being matched against the current engine in the meantime, and only
+  // the most recently started build is ever published.
+  void BuildAdBlockClient(EngineBuilder builder);
+  void BuildAdBlockClientFromRules(const std::string& rules);
   void ResetForTest(const std::string& rules, const std::string& resources);
+  // Must be called whenever |ad_block_client_| is replaced or reconfigured.
+  void ClearDecisionCache();
 
-  std::unique_ptr<adblock::Engine> ad_block_client_;
+  // True when requests may be matched on sequences other than the adblock
+  // task runner, see features::kBraveAdblockParallelMatching.
+  const bool parallel_matching_;
 
  private:
-  void UpdateAdBlockClient(
-      std::unique_ptr<adblock::Engine> ad_block_client);
-  void OnGetDATFileData(GetDATFileDataResult result);
+  // Rebuilds the engine from |engine_builder_| shortly, once for all the tag
+  // and resource changes made in the meantime.
+  void RebuildAdBlockClientSoon();
+  void RebuildAdBlockClient();
+  void PublishAdBlockClient(uint64_t build_id,
+                            const std::vector<std::string>& built_tags,
+                            const std::string& built_resources,
+                            std::unique_ptr<adblock::Engine> ad_block_client);
   void OnPreferenceChanges(const std::string& pref_name);
 
+  // Only replaced on the adblock task runner, which reads it without locking.
+  // Other sequences go through GetEngineSnapshot().
+  scoped_refptr<AdBlockEngineSnapshot> ad_block_client_;
+  base::Lock ad_block_client_lock_;
+  // The builder of the most recently started BuildAdBlockClient() call, kept
+  // to rebuild the engine when parallel matching is enabled.
+  EngineBuilder engine_builder_;
+  // Identifies the most recently started BuildAdBlockClient() call.
+  uint64_t latest_build_id_ = 0;
+  // True until the most recently started build has finished.
+  bool build_in_progress_ = false;
+  bool rebuild_pending_ = false;
   std::vector<std::string> tags_;
   std::string resources_;
+  std::unique_ptr<AdBlockDecisionCache> decision_cache_;
   base::WeakPtrFactory<AdBlockBaseService> weak_factory_;
   DISALLOW_COPY_AND_ASSIGN(AdBlockBaseService);
 };
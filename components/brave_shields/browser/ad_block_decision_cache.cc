@@ -0,0 +1,88 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/ad_block_decision_cache.h"
+
+#include <utility>
+
+#include "base/metrics/histogram_macros.h"
+#include "base/strings/string_number_conversions.h"
+
+namespace brave_shields {
+
+namespace {
+
+// Lookups between two reports of the hit rate.
+const uint64_t kMetricsInterval = 1000;
+
+std::string GetDecisionKey(const GURL& url,
+                           blink::mojom::ResourceType resource_type) {
+  return base::NumberToString(static_cast<int>(resource_type)) + " " +
+         url.spec();
+}
+
+}  // namespace
+
+AdBlockDecisionCache::AdBlockDecisionCache(size_t max_hosts,
+                                           size_t max_decisions_per_host)
+    : max_decisions_per_host_(max_decisions_per_host),
+      hosts_(max_hosts),
+      lookups_(0),
+      hits_(0) {}
+
+AdBlockDecisionCache::~AdBlockDecisionCache() = default;
+
+bool AdBlockDecisionCache::Get(const std::string& tab_host,
+                               const GURL& url,
+                               blink::mojom::ResourceType resource_type,
+                               AdBlockMatchResult* result) {
+  auto host_it = hosts_.Get(tab_host);
+  if (host_it == hosts_.end()) {
+    RecordLookup(false);
+    return false;
+  }
+
+  HostDecisions* decisions = host_it->second.get();
+  auto it = decisions->Get(GetDecisionKey(url, resource_type));
+  if (it == decisions->end()) {
+    RecordLookup(false);
+    return false;
+  }
+
+  *result = it->second;
+  RecordLookup(true);
+  return true;
+}
+
+void AdBlockDecisionCache::Put(const std::string& tab_host,
+                               const GURL& url,
+                               blink::mojom::ResourceType resource_type,
+                               const AdBlockMatchResult& result) {
+  auto host_it = hosts_.Get(tab_host);
+  if (host_it == hosts_.end()) {
+    host_it = hosts_.Put(
+        tab_host, std::make_unique<HostDecisions>(max_decisions_per_host_));
+  }
+  host_it->second->Put(GetDecisionKey(url, resource_type), result);
+}
+
+void AdBlockDecisionCache::Clear() {
+  hosts_.Clear();
+}
+
+void AdBlockDecisionCache::RecordLookup(bool hit) {
+  lookups_++;
+  if (hit)
+    hits_++;
+  if (lookups_ < kMetricsInterval)
+    return;
+
+  UMA_HISTOGRAM_PERCENTAGE("Brave.Adblock.DecisionCache.HitRate",
+                           static_cast<int>(100 * hits_ / lookups_));
+  lookups_ = 0;
+  hits_ = 0;
+}
+
+}  // namespace brave_shields
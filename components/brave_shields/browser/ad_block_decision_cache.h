@@ -0,0 +1,59 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_AD_BLOCK_DECISION_CACHE_H_
+#define BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_AD_BLOCK_DECISION_CACHE_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "base/containers/mru_cache.h"
+#include "base/macros.h"
+#include "brave/components/brave_shields/browser/ad_block_base_service.h"
+#include "third_party/blink/public/mojom/loader/resource_load_info.mojom-shared.h"
+#include "url/gurl.h"
+
+namespace brave_shields {
+
+// Remembers the outcome of matching a (request URL, resource type) pair on a
+// given tab host, so requests repeated within a page or across reloads skip
+// the engine. Bounded both in the number of tab hosts and in the number of
+// decisions per host, least recently used entries are dropped first.
+//
+// Not thread safe, owned and used on the adblock task runner.
+class AdBlockDecisionCache {
+ public:
+  AdBlockDecisionCache(size_t max_hosts, size_t max_decisions_per_host);
+  ~AdBlockDecisionCache();
+
+  bool Get(const std::string& tab_host,
+           const GURL& url,
+           blink::mojom::ResourceType resource_type,
+           AdBlockMatchResult* result);
+  void Put(const std::string& tab_host,
+           const GURL& url,
+           blink::mojom::ResourceType resource_type,
+           const AdBlockMatchResult& result);
+  // Drops every decision, must be called whenever the engine changes.
+  void Clear();
+
+ private:
+  using HostDecisions = base::HashingMRUCache<std::string, AdBlockMatchResult>;
+
+  void RecordLookup(bool hit);
+
+  const size_t max_decisions_per_host_;
+  base::HashingMRUCache<std::string, std::unique_ptr<HostDecisions>> hosts_;
+  uint64_t lookups_;
+  uint64_t hits_;
+
+  DISALLOW_COPY_AND_ASSIGN(AdBlockDecisionCache);
+};
+
+}  // namespace brave_shields
+
+#endif  // BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_AD_BLOCK_DECISION_CACHE_H_
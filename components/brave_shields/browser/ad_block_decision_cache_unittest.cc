@@ -0,0 +1,78 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/ad_block_decision_cache.h"
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+using brave_shields::AdBlockDecisionCache;
+using brave_shields::AdBlockMatchResult;
+using blink::mojom::ResourceType;
+
+namespace {
+
+AdBlockMatchResult MakeResult(bool should_start,
+                              bool did_match_exception,
+                              const std::string& mock_data_url) {
+  AdBlockMatchResult result;
+  result.should_start = should_start;
+  result.did_match_exception = did_match_exception;
+  result.mock_data_url = mock_data_url;
+  return result;
+}
+
+}  // namespace
+
+TEST(AdBlockDecisionCacheTest, StoresDecisionsPerTabHost) {
+  AdBlockDecisionCache cache(4, 4);
+  const GURL url("https://ads.example.com/ad.js");
+  cache.Put("a.com", url, ResourceType::kScript,
+            MakeResult(false, false, "data:text/javascript,"));
+  cache.Put("b.com", url, ResourceType::kScript, MakeResult(true, true, ""));
+
+  AdBlockMatchResult result;
+  ASSERT_TRUE(cache.Get("a.com", url, ResourceType::kScript, &result));
+  EXPECT_FALSE(result.should_start);
+  EXPECT_FALSE(result.did_match_exception);
+  EXPECT_EQ("data:text/javascript,", result.mock_data_url);
+
+  ASSERT_TRUE(cache.Get("b.com", url, ResourceType::kScript, &result));
+  EXPECT_TRUE(result.should_start);
+  EXPECT_TRUE(result.did_match_exception);
+  EXPECT_EQ("", result.mock_data_url);
+
+  // The resource type is part of the key.
+  EXPECT_FALSE(cache.Get("a.com", url, ResourceType::kImage, &result));
+  EXPECT_FALSE(cache.Get("c.com", url, ResourceType::kScript, &result));
+}
+
+TEST(AdBlockDecisionCacheTest, IsBounded) {
+  AdBlockDecisionCache cache(2, 2);
+  const GURL url1("https://example.com/1");
+  const GURL url2("https://example.com/2");
+  const GURL url3("https://example.com/3");
+  AdBlockMatchResult result;
+
+  cache.Put("a.com", url1, ResourceType::kImage, MakeResult(true, false, ""));
+  cache.Put("a.com", url2, ResourceType::kImage, MakeResult(true, false, ""));
+  cache.Put("a.com", url3, ResourceType::kImage, MakeResult(true, false, ""));
+  EXPECT_FALSE(cache.Get("a.com", url1, ResourceType::kImage, &result));
+  EXPECT_TRUE(cache.Get("a.com", url3, ResourceType::kImage, &result));
+
+  cache.Put("b.com", url1, ResourceType::kImage, MakeResult(true, false, ""));
+  cache.Put("c.com", url1, ResourceType::kImage, MakeResult(true, false, ""));
+  EXPECT_FALSE(cache.Get("a.com", url3, ResourceType::kImage, &result));
+  EXPECT_TRUE(cache.Get("c.com", url1, ResourceType::kImage, &result));
+}
+
+TEST(AdBlockDecisionCacheTest, Clear) {
+  AdBlockDecisionCache cache(2, 2);
+  const GURL url("https://example.com/ad.png");
+  cache.Put("a.com", url, ResourceType::kImage, MakeResult(false, false, ""));
+  cache.Clear();
+
+  AdBlockMatchResult result;
+  EXPECT_FALSE(cache.Get("a.com", url, ResourceType::kImage, &result));
+}
@@ -144,6 +144,29 @@ bool AdBlockRegionalServiceManager::ShouldStartRequest(
   return true;
 }
 
+void AdBlockRegionalServiceManager::MatchRequests(
+    const std::vector<AdBlockMatchRequest>& requests,
+    std::vector<AdBlockMatchResult>* results) {
+  if (!delegate_->GetTaskRunner()->RunsTasksInCurrentSequence()) {
+    // Matching sequences only hold the lock while taking the current
+    // engines, so they do not serialize on each other.
+    std::vector<scoped_refptr<AdBlockEngineSnapshot>> snapshots;
+    {
+      base::AutoLock lock(regional_services_lock_);
+      for (const auto& regional_service : regional_services_)
+        snapshots.push_back(regional_service.second->GetEngineSnapshot());
+    }
+    for (const auto& snapshot : snapshots)
+      AdBlockBaseService::MatchRequestsAgainst(*snapshot, requests, results);
+    return;
+  }
+
+  base::AutoLock lock(regional_services_lock_);
+  for (const auto& regional_service : regional_services_) {
+    regional_service.second->MatchRequests(requests, results);
+  }
+}
+
 void AdBlockRegionalServiceManager::EnableTag(const std::string& tag,
                                               bool enabled) {
   base::AutoLock lock(regional_services_lock_);
@@ -193,20 +216,14 @@ void AdBlockRegionalServiceManager::EnableFilterList(
                      base::Unretained(this), uuid, enabled));
 }
 
-base::Optional<base::Value>
+base::Optional<CosmeticResources>
 AdBlockRegionalServiceManager::UrlCosmeticResources(
         const std::string& url) {
   base::AutoLock lock(regional_services_lock_);
-  auto it = regional_services_.begin();
-  if (it == regional_services_.end()) {
-    return base::Optional<base::Value>();
-  }
-  base::Optional<base::Value> first_value =
-      it->second->UrlCosmeticResources(url);
-
-  for ( ; it != regional_services_.end(); it++) {
-    base::Optional<base::Value> next_value =
-        it->second->UrlCosmeticResources(url);
+  base::Optional<CosmeticResources> first_value;
+  for (const auto& regional_service : regional_services_) {
+    base::Optional<CosmeticResources> next_value =
+        regional_service.second->UrlCosmeticResources(url);
     if (first_value) {
       if (next_value) {
         MergeResourcesInto(std::move(*next_value), &*first_value, false);
@@ -219,36 +236,21 @@ AdBlockRegionalServiceManager::UrlCosmeticResources(
   return first_value;
 }
 
-base::Optional<base::Value>
+std::vector<std::string>
 AdBlockRegionalServiceManager::HiddenClassIdSelectors(
         const std::vector<std::string>& classes,
         const std::vector<std::string>& ids,
         const std::vector<std::string>& exceptions) {
   base::AutoLock lock(regional_services_lock_);
-  auto it = regional_services_.begin();
-  if (it == regional_services_.end()) {
-    return base::Optional<base::Value>();
-  }
-  base::Optional<base::Value> first_value =
-      it->second->HiddenClassIdSelectors(classes, ids, exceptions);
-
-  for ( ; it != regional_services_.end(); it++) {
-    base::Optional<base::Value> next_value =
-        it->second->HiddenClassIdSelectors(classes, ids, exceptions);
-    if (first_value && first_value->is_list()) {
-      if (next_value && next_value->is_list()) {
-        for (auto i = next_value->GetList().begin();
-                i < next_value->GetList().end();
-                i++) {
-          first_value->Append(std::move(*i));
-        }
-      }
-    } else {
-      first_value = std::move(next_value);
-    }
+  std::vector<std::string> selectors;
+  for (const auto& regional_service : regional_services_) {
+    MergeSelectorsInto(
+        regional_service.second->HiddenClassIdSelectors(classes, ids,
+                                                         exceptions),
+        &selectors);
   }
 
-  return first_value;
+  return selectors;
 }
 
 void AdBlockRegionalServiceManager::SetRegionalCatalog(
@@ -17,6 +17,7 @@
 #include "base/synchronization/lock.h"
 #include "base/values.h"
 #include "brave/components/brave_component_updater/browser/brave_component.h"
+#include "brave/components/brave_shields/browser/cosmetic_resources.h"
 #include "brave/vendor/adblock_rust_ffi/src/wrapper.hpp"
 #include "third_party/blink/public/mojom/loader/resource_load_info.mojom-shared.h"
 #include "url/gurl.h"
@@ -32,6 +33,8 @@ using brave_component_updater::BraveComponent;
 namespace brave_shields {
 
 class AdBlockRegionalService;
+struct AdBlockMatchRequest;
+struct AdBlockMatchResult;
 
 // The AdBlock regional service manager, in charge of initializing and
 // managing regional AdBlock clients.
@@ -52,13 +55,17 @@ class AdBlockRegionalServiceManager {
                           const std::string& tab_host,
                           bool* matching_exception_filter,
                           std::string* mock_data_url);
+  // Batched counterpart of ShouldStartRequest(), see
+  // AdBlockBaseService::MatchRequests().
+  void MatchRequests(const std::vector<AdBlockMatchRequest>& requests,
+                     std::vector<AdBlockMatchResult>* results);
   void EnableTag(const std::string& tag, bool enabled);
   void AddResources(const std::string& resources);
   void EnableFilterList(const std::string& uuid, bool enabled);
 
-  base::Optional<base::Value> UrlCosmeticResources(
+  base::Optional<CosmeticResources> UrlCosmeticResources(
           const std::string& url);
-  base::Optional<base::Value> HiddenClassIdSelectors(
+  std::vector<std::string> HiddenClassIdSelectors(
           const std::vector<std::string>& classes,
           const std::vector<std::string>& ids,
           const std::vector<std::string>& exceptions);
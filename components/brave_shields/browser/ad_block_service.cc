@@ -16,13 +16,17 @@
 #include "base/memory/ptr_util.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/system/sys_info.h"
+#include "base/task/post_task.h"
 #include "base/threading/thread_restrictions.h"
 #include "brave/browser/brave_browser_process_impl.h"
 #include "brave/common/pref_names.h"
 #include "brave/components/brave_shields/browser/ad_block_custom_filters_service.h"
 #include "brave/components/brave_shields/browser/ad_block_regional_service_manager.h"
 #include "brave/components/brave_shields/browser/ad_block_service_helper.h"
+#include "brave/components/brave_shields/browser/hidden_class_id_sessions.h"
 #include "brave/components/brave_shields/common/brave_shield_constants.h"
+#include "brave/components/brave_shields/common/features.h"
 #include "brave/vendor/adblock_rust_ffi/src/wrapper.hpp"
 #include "components/prefs/pref_registry_simple.h"
 #include "components/prefs/pref_service.h"
@@ -35,6 +39,9 @@ namespace brave_shields {
 
 namespace {
 
+// Frames whose already answered class and id tokens are remembered.
+const size_t kHiddenClassIdSessionsMaxFrames = 256;
+
 std::string GetTagFromPrefName(const std::string& pref_name) {
   if (pref_name == kFBEmbedControlType) {
     return brave_shields::kFacebookEmbeds;
@@ -106,30 +113,91 @@ bool AdBlockService::ShouldStartRequest(
   return true;
 }
 
+std::vector<AdBlockMatchResult> AdBlockService::ShouldStartRequests(
+    const std::vector<AdBlockMatchRequest>& requests) {
+  // Same engine order as ShouldStartRequest(), but each engine walks the
+  // whole batch and skips requests an earlier engine already decided.
+  std::vector<AdBlockMatchResult> results =
+      AdBlockBaseService::ShouldStartRequests(requests);
+  regional_service_manager()->MatchRequests(requests, &results);
+  custom_filters_service()->MatchRequests(requests, &results);
+  return results;
+}
+
+scoped_refptr<base::SequencedTaskRunner>
+AdBlockService::GetMatchingTaskRunner() {
+  if (matching_task_runners_.empty())
+    return GetTaskRunner();
+  return matching_task_runners_[next_matching_task_runner_++ %
+                                matching_task_runners_.size()];
+}
+
 AdBlockRegionalServiceManager* AdBlockService::regional_service_manager() {
-  if (!regional_service_manager_)
-    regional_service_manager_ =
-        brave_shields::AdBlockRegionalServiceManagerFactory(
-            component_delegate_);
   return regional_service_manager_.get();
 }
 
 brave_shields::AdBlockCustomFiltersService*
 AdBlockService::custom_filters_service() {
-  if (!custom_filters_service_)
-    custom_filters_service_ =
-        brave_shields::AdBlockCustomFiltersServiceFactory(
-            component_delegate_);
   return custom_filters_service_.get();
 }
 
+HiddenClassIdSessions* AdBlockService::hidden_class_id_sessions() {
+  DCHECK(GetTaskRunner()->RunsTasksInCurrentSequence());
+  return hidden_class_id_sessions_.get();
+}
+
+void AdBlockService::OnFrameNavigated(int tab_id, int frame_id) {
+  // The sessions are deleted on the task runner after any task posted here.
+  HiddenClassIdSessions* sessions = hidden_class_id_sessions_.get();
+  if (frame_id == 0) {
+    GetTaskRunner()->PostTask(
+        FROM_HERE, base::BindOnce(&HiddenClassIdSessions::ResetTab,
+                                  base::Unretained(sessions), tab_id));
+  } else {
+    GetTaskRunner()->PostTask(
+        FROM_HERE, base::BindOnce(&HiddenClassIdSessions::ResetFrame,
+                                  base::Unretained(sessions), tab_id,
+                                  frame_id));
+  }
+}
+
+void AdBlockService::OnHiddenClassIdSelectorsSent(
+    int tab_id,
+    int frame_id,
+    std::vector<std::string> classes,
+    std::vector<std::string> ids) {
+  // The sessions are deleted on the task runner after any task posted here.
+  GetTaskRunner()->PostTask(
+      FROM_HERE,
+      base::BindOnce(&HiddenClassIdSessions::MarkSent,
+                     base::Unretained(hidden_class_id_sessions_.get()), tab_id,
+                     frame_id, std::move(classes), std::move(ids)));
+}
+
 AdBlockService::AdBlockService(
     brave_component_updater::BraveComponent::Delegate* delegate)
     : AdBlockBaseService(delegate),
-      component_delegate_(delegate) {
+      regional_service_manager_(
+          brave_shields::AdBlockRegionalServiceManagerFactory(delegate)),
+      custom_filters_service_(
+          brave_shields::AdBlockCustomFiltersServiceFactory(delegate)),
+      hidden_class_id_sessions_(std::make_unique<HiddenClassIdSessions>(
+          kHiddenClassIdSessionsMaxFrames)) {
+  if (parallel_matching_) {
+    int sequences = features::kBraveAdblockParallelMatchingSequences.Get();
+    if (sequences <= 0)
+      sequences = base::SysInfo::NumberOfProcessors();
+    for (int i = 0; i < sequences; ++i) {
+      matching_task_runners_.push_back(base::CreateSequencedTaskRunner(
+          {base::ThreadPool(), base::TaskPriority::USER_BLOCKING,
+           base::TaskShutdownBehavior::SKIP_ON_SHUTDOWN}));
+    }
+  }
 }
 
-AdBlockService::~AdBlockService() {}
+AdBlockService::~AdBlockService() {
+  GetTaskRunner()->DeleteSoon(FROM_HERE, std::move(hidden_class_id_sessions_));
+}
 
 bool AdBlockService::Init() {
   // Initializes adblock-rust's domain resolution implementation
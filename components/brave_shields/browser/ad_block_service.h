@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -27,6 +28,7 @@ namespace brave_shields {
 
 class AdBlockRegionalServiceManager;
 class AdBlockCustomFiltersService;
+class HiddenClassIdSessions;
 
 const char kAdBlockResourcesFilename[] = "resources.json";
 const char kAdBlockComponentName[] = "Brave Ad Block Updater";
@@ -51,9 +53,27 @@ class AdBlockService : public AdBlockBaseService {
                           const std::string& tab_host,
                           bool* did_match_exception,
                           std::string* mock_data_url) override;
+  std::vector<AdBlockMatchResult> ShouldStartRequests(
+      const std::vector<AdBlockMatchRequest>& requests) override;
+
+  // Returns the sequence to match the next batch of ad block checks on. This
+  // is the adblock task runner unless parallel matching is enabled, in which
+  // case consecutive batches are spread over the matching sequences.
+  scoped_refptr<base::SequencedTaskRunner> GetMatchingTaskRunner();
 
   AdBlockRegionalServiceManager* regional_service_manager();
   AdBlockCustomFiltersService* custom_filters_service();
+  // Must only be used on the task runner.
+  HiddenClassIdSessions* hidden_class_id_sessions();
+  // Forgets the class and id tokens seen by the frame, or by every frame of
+  // the tab when |frame_id| is the main frame's.
+  void OnFrameNavigated(int tab_id, int frame_id);
+  // Has the frame's session remember the tokens whose selectors were sent
+  // back to the extension.
+  void OnHiddenClassIdSelectorsSent(int tab_id,
+                                    int frame_id,
+                                    std::vector<std::string> classes,
+                                    std::vector<std::string> ids);
 
  protected:
   bool Init() override;
@@ -72,12 +92,15 @@ class AdBlockService : public AdBlockBaseService {
       const std::string& component_id,
       const std::string& component_base64_public_key);
 
+  // Created up front, since the matching sequences use them without locking.
   std::unique_ptr<brave_shields::AdBlockRegionalServiceManager>
       regional_service_manager_;
   std::unique_ptr<brave_shields::AdBlockCustomFiltersService>
       custom_filters_service_;
-
-  BraveComponent::Delegate* component_delegate_;
+  std::unique_ptr<HiddenClassIdSessions> hidden_class_id_sessions_;
+  std::vector<scoped_refptr<base::SequencedTaskRunner>>
+      matching_task_runners_;
+  std::atomic<size_t> next_matching_task_runner_{0};
 
   base::WeakPtrFactory<AdBlockService> weak_factory_{this};
   DISALLOW_COPY_AND_ASSIGN(AdBlockService);
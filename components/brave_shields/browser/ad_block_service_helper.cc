@@ -6,6 +6,7 @@
 #include "brave/components/brave_shields/browser/ad_block_service_helper.h"
 
 #include <algorithm>
+#include <iterator>
 #include <utility>
 
 #include "base/json/json_reader.h"
@@ -115,80 +116,48 @@ std::vector<FilterList> RegionalCatalogFromJSON(
   return catalog;
 }
 
-// Merges the contents of the second UrlCosmeticResources Value into the first
-// one provided.
+// Merges the contents of the second CosmeticResources into the first one
+// provided.
 //
 // If `force_hide` is true, the contents of `from`'s `hide_selectors` field
 // will be moved into a possibly new field of `into` called
 // `force_hide_selectors`.
-void MergeResourcesInto(base::Value from, base::Value* into, bool force_hide) {
-  base::Value* resources_hide_selectors = nullptr;
+void MergeResourcesInto(CosmeticResources from,
+                        CosmeticResources* into,
+                        bool force_hide) {
   if (force_hide) {
-    resources_hide_selectors = into->FindKey("force_hide_selectors");
-    if (!resources_hide_selectors || !resources_hide_selectors->is_list()) {
-        into->SetKey("force_hide_selectors", base::ListValue());
-        resources_hide_selectors = into->FindKey("force_hide_selectors");
-    }
+    if (!into->force_hide_selectors)
+      into->force_hide_selectors.emplace();
+    MergeSelectorsInto(std::move(from.hide_selectors),
+                       &*into->force_hide_selectors);
   } else {
-    resources_hide_selectors = into->FindKey("hide_selectors");
-  }
-  base::Value* from_resources_hide_selectors =
-      from.FindKey("hide_selectors");
-  if (resources_hide_selectors && from_resources_hide_selectors) {
-    for (auto i = from_resources_hide_selectors->GetList().begin();
-            i < from_resources_hide_selectors->GetList().end();
-            i++) {
-      resources_hide_selectors->Append(std::move(*i));
-    }
+    MergeSelectorsInto(std::move(from.hide_selectors), &into->hide_selectors);
   }
 
-  base::Value* resources_style_selectors = into->FindKey("style_selectors");
-  base::Value* from_resources_style_selectors =
-      from.FindKey("style_selectors");
-  if (resources_style_selectors && from_resources_style_selectors) {
-    for (auto i : from_resources_style_selectors->DictItems()) {
-      base::Value* resources_entry =
-          resources_style_selectors->FindKey(i.first);
-      if (resources_entry) {
-        for (auto j = i.second.GetList().begin();
-                j < i.second.GetList().end();
-                j++) {
-          resources_entry->Append(std::move(*j));
-        }
-      } else {
-        resources_style_selectors->SetKey(i.first, std::move(i.second));
-      }
-    }
+  for (auto& item : from.style_selectors) {
+    MergeSelectorsInto(std::move(item.second),
+                       &into->style_selectors[item.first]);
   }
 
-  base::Value* resources_exceptions = into->FindKey("exceptions");
-  base::Value* from_resources_exceptions = from.FindKey("exceptions");
-  if (resources_exceptions && from_resources_exceptions) {
-    for (auto i = from_resources_exceptions->GetList().begin();
-            i < from_resources_exceptions->GetList().end();
-            i++) {
-      resources_exceptions->Append(std::move(*i));
-    }
-  }
+  MergeSelectorsInto(std::move(from.exceptions), &into->exceptions);
 
-  base::Value* resources_injected_script = into->FindKey("injected_script");
-  base::Value* from_resources_injected_script =
-      from.FindKey("injected_script");
-  if (resources_injected_script && from_resources_injected_script) {
-    *resources_injected_script = base::Value(
-            resources_injected_script->GetString()
-            + '\n'
-            + from_resources_injected_script->GetString());
-  }
+  into->injected_script.reserve(into->injected_script.size() + 1 +
+                                from.injected_script.size());
+  into->injected_script += '\n';
+  into->injected_script += from.injected_script;
 
-  base::Value* resources_generichide = into->FindKey("generichide");
-  base::Value* from_resources_generichide =
-      from.FindKey("generichide");
-  if (from_resources_generichide) {
-    if (from_resources_generichide->GetBool()) {
-      *resources_generichide = base::Value(true);
-    }
+  if (from.generichide)
+    into->generichide = true;
+}
+
+void MergeSelectorsInto(std::vector<std::string> from,
+                        std::vector<std::string>* into) {
+  if (into->empty()) {
+    *into = std::move(from);
+    return;
   }
+  into->insert(into->end(), std::make_move_iterator(from.begin()),
+               std::make_move_iterator(from.end()));
 }
 
 }  // namespace brave_shields
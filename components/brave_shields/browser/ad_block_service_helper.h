@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "base/values.h"
+#include "brave/components/brave_shields/browser/cosmetic_resources.h"
 #include "brave/vendor/adblock_rust_ffi/src/wrapper.hpp"
 
 namespace brave_shields {
@@ -25,7 +26,12 @@ std::vector<adblock::FilterList>::const_iterator FindAdBlockFilterListByLocale(
 std::vector<adblock::FilterList> RegionalCatalogFromJSON(
     const std::string& catalog_json);
 
-void MergeResourcesInto(base::Value from, base::Value* into, bool force_hide);
+void MergeResourcesInto(CosmeticResources from,
+                        CosmeticResources* into,
+                        bool force_hide);
+
+void MergeSelectorsInto(std::vector<std::string> from,
+                        std::vector<std::string>* into);
 
 }  // namespace brave_shields
 
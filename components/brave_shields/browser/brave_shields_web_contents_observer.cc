@@ -12,8 +12,10 @@
 #include <vector>
 
 #include "base/strings/utf_string_conversions.h"
+#include "brave/browser/brave_browser_process_impl.h"
 #include "brave/common/pref_names.h"
 #include "brave/common/render_messages.h"
+#include "brave/components/brave_shields/browser/ad_block_service.h"
 #include "brave/components/brave_shields/browser/brave_shields_util.h"
 #include "brave/components/brave_shields/common/brave_shield_constants.h"
 #include "brave/content/common/frame_messages.h"
@@ -181,6 +183,15 @@ void BraveShieldsWebContentsObserver::DidFinishNavigation(
   if (!web_contents() || !main_frame) {
     return;
   }
+#if BUILDFLAG(ENABLE_EXTENSIONS)
+  // A new document starts without any hidden class or id selector applied.
+  if (navigation_handle->HasCommitted() &&
+      !navigation_handle->IsSameDocument()) {
+    g_brave_browser_process->ad_block_service()->OnFrameNavigated(
+        extensions::ExtensionTabUtil::GetTabId(web_contents()),
+        extensions::ExtensionApiFrameIdMap::GetFrameId(navigation_handle));
+  }
+#endif
   int process_id = main_frame->GetProcess()->GetID();
   int routing_id = main_frame->GetRoutingID();
   int tree_node_id = main_frame->GetFrameTreeNodeId();
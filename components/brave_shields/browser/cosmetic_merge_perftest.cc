@@ -0,0 +1,79 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <string>
+#include <utility>
+
+#include "base/json/json_writer.h"
+#include "base/strings/stringprintf.h"
+#include "base/timer/elapsed_timer.h"
+#include "brave/components/brave_shields/browser/ad_block_service_helper.h"
+#include "brave/components/brave_shields/browser/cosmetic_resources.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace brave_shields {
+
+namespace {
+
+const int kSelectorCount = 5000;
+const int kIterations = 10;
+
+// Builds engine results with |count| entries in each list, using |prefix| to
+// keep the selectors of each engine distinct.
+std::string BuildResources(const std::string& prefix, int count) {
+  base::Value hide_selectors(base::Value::Type::LIST);
+  base::Value style_selectors(base::Value::Type::DICTIONARY);
+  base::Value exceptions(base::Value::Type::LIST);
+  for (int i = 0; i < count; ++i) {
+    hide_selectors.Append(base::StringPrintf(".%s-ad-%d", prefix.c_str(), i));
+    base::Value styles(base::Value::Type::LIST);
+    styles.Append("display: none !important");
+    style_selectors.SetKey(base::StringPrintf("#%s-%d", prefix.c_str(), i),
+                           std::move(styles));
+    exceptions.Append(base::StringPrintf(".%s-ok-%d", prefix.c_str(), i));
+  }
+  base::Value resources(base::Value::Type::DICTIONARY);
+  resources.SetKey("hide_selectors", std::move(hide_selectors));
+  resources.SetKey("style_selectors", std::move(style_selectors));
+  resources.SetKey("exceptions", std::move(exceptions));
+  resources.SetStringKey("injected_script", "console.log('" + prefix + "')");
+  resources.SetBoolKey("generichide", false);
+  std::string json;
+  base::JSONWriter::Write(resources, &json);
+  return json;
+}
+
+}  // namespace
+
+// Measures parsing the results of the default, regional and custom engines,
+// merging them and producing the value sent to the renderer.
+TEST(CosmeticResourceMergePerfTest, ParseMergeSerialize) {
+  const std::string default_json = BuildResources("default", kSelectorCount);
+  const std::string regional_json = BuildResources("regional", kSelectorCount);
+  const std::string custom_json = BuildResources("custom", kSelectorCount);
+
+  base::ElapsedTimer timer;
+  for (int i = 0; i < kIterations; ++i) {
+    base::Optional<CosmeticResources> resources =
+        CosmeticResources::FromJSON(default_json);
+    ASSERT_TRUE(resources);
+    MergeResourcesInto(*CosmeticResources::FromJSON(regional_json),
+                       &*resources, false);
+    MergeResourcesInto(*CosmeticResources::FromJSON(custom_json),
+                       &*resources, true);
+    ASSERT_EQ(2u * kSelectorCount, resources->hide_selectors.size());
+    ASSERT_EQ(static_cast<size_t>(kSelectorCount),
+              resources->force_hide_selectors->size());
+    base::Value value = resources->TakeValue();
+    ASSERT_TRUE(value.is_dict());
+  }
+
+  perf_test::PerfResultReporter reporter("CosmeticResourceMerge", "url");
+  reporter.RegisterImportantMetric(".parse_merge_serialize", "ms");
+  reporter.AddResult(".parse_merge_serialize", timer.Elapsed() / kIterations);
+}
+
+}  // namespace brave_shields
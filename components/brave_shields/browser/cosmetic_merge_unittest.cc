@@ -3,8 +3,14 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this file,
  * You can obtain one at http://mozilla.org/MPL/2.0/. */
 
+#include <string>
+#include <utility>
+
 #include "base/json/json_reader.h"
+#include "base/json/json_writer.h"
+#include "base/strings/stringprintf.h"
 #include "brave/components/brave_shields/browser/ad_block_service_helper.h"
+#include "brave/components/brave_shields/browser/cosmetic_resources.h"
 #include "testing/gmock/include/gmock/gmock.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -22,10 +28,10 @@ class CosmeticResourceMergeTest : public testing::Test {
           const std::string& b,
           bool force_hide,
           const std::string& expected) {
-    base::Optional<base::Value> a_val = base::JSONReader::Read(a);
+    base::Optional<CosmeticResources> a_val = CosmeticResources::FromJSON(a);
     ASSERT_TRUE(a_val);
 
-    base::Optional<base::Value> b_val = base::JSONReader::Read(b);
+    base::Optional<CosmeticResources> b_val = CosmeticResources::FromJSON(b);
     ASSERT_TRUE(b_val);
 
     const base::Optional<base::Value> expected_val =
@@ -34,7 +40,7 @@ class CosmeticResourceMergeTest : public testing::Test {
 
     MergeResourcesInto(std::move(b_val.value()), &*a_val, force_hide);
 
-    ASSERT_EQ(*a_val, *expected_val);
+    ASSERT_EQ(a_val->TakeValue(), *expected_val);
   }
 
  protected:
@@ -306,5 +312,62 @@ TEST_F(CosmeticResourceMergeTest, MergeStyles) {
   CompareMergeFromStrings(a, b, false, expected);
 }
 
+TEST_F(CosmeticResourceMergeTest, RejectsNonDictionary) {
+  EXPECT_FALSE(CosmeticResources::FromJSON("[]"));
+  EXPECT_FALSE(CosmeticResources::FromJSON("not json"));
+  EXPECT_TRUE(HiddenClassIdSelectorsFromJSON("{}").empty());
+  EXPECT_EQ(std::vector<std::string>({".a", "#b"}),
+            HiddenClassIdSelectorsFromJSON("[\".a\", 1, \"#b\"]"));
+}
+
+// Builds resources shaped like the fixtures above with |count| entries in
+// each list, using |prefix| to keep the selectors of each engine distinct.
+std::string BuildLargeResources(const std::string& prefix, int count) {
+  base::Value hide_selectors(base::Value::Type::LIST);
+  base::Value style_selectors(base::Value::Type::DICTIONARY);
+  base::Value exceptions(base::Value::Type::LIST);
+  for (int i = 0; i < count; ++i) {
+    hide_selectors.Append(base::StringPrintf(".%s-ad-%d", prefix.c_str(), i));
+    base::Value styles(base::Value::Type::LIST);
+    styles.Append("display: none !important");
+    style_selectors.SetKey(base::StringPrintf("#%s-%d", prefix.c_str(), i),
+                           std::move(styles));
+    exceptions.Append(base::StringPrintf(".%s-ok-%d", prefix.c_str(), i));
+  }
+  base::Value resources(base::Value::Type::DICTIONARY);
+  resources.SetKey("hide_selectors", std::move(hide_selectors));
+  resources.SetKey("style_selectors", std::move(style_selectors));
+  resources.SetKey("exceptions", std::move(exceptions));
+  resources.SetStringKey("injected_script", "console.log('" + prefix + "')");
+  resources.SetBoolKey("generichide", false);
+  std::string json;
+  base::JSONWriter::Write(resources, &json);
+  return json;
+}
+
+// Merges the results of the default, regional and custom engines into the
+// value sent to the renderer.
+TEST_F(CosmeticResourceMergeTest, MergeDefaultRegionalAndCustomResources) {
+  const int kSelectorCount = 20;
+  const std::string default_json = BuildLargeResources("default",
+                                                       kSelectorCount);
+  const std::string regional_json = BuildLargeResources("regional",
+                                                        kSelectorCount);
+  const std::string custom_json = BuildLargeResources("custom",
+                                                      kSelectorCount);
+
+  base::Optional<CosmeticResources> resources =
+      CosmeticResources::FromJSON(default_json);
+  ASSERT_TRUE(resources);
+  MergeResourcesInto(*CosmeticResources::FromJSON(regional_json),
+                     &*resources, false);
+  MergeResourcesInto(*CosmeticResources::FromJSON(custom_json),
+                     &*resources, true);
+  EXPECT_EQ(2u * kSelectorCount, resources->hide_selectors.size());
+  EXPECT_EQ(static_cast<size_t>(kSelectorCount),
+            resources->force_hide_selectors->size());
+  base::Value value = resources->TakeValue();
+  EXPECT_TRUE(value.is_dict());
+}
 
 }  // namespace brave_shields
@@ -0,0 +1,103 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/cosmetic_resources.h"
+
+#include <utility>
+
+#include "base/json/json_reader.h"
+
+namespace brave_shields {
+
+namespace {
+
+// Moves the strings of the list |value| to the end of |out|, ignoring
+// entries of any other type.
+void TakeStrings(base::Value* value, std::vector<std::string>* out) {
+  if (!value || !value->is_list())
+    return;
+  out->reserve(out->size() + value->GetList().size());
+  for (auto& item : value->GetList()) {
+    if (item.is_string())
+      out->push_back(std::move(item.GetString()));
+  }
+}
+
+base::Value ToListValue(std::vector<std::string>* strings) {
+  base::Value list(base::Value::Type::LIST);
+  for (auto& string : *strings)
+    list.Append(base::Value(std::move(string)));
+  strings->clear();
+  return list;
+}
+
+}  // namespace
+
+CosmeticResources::CosmeticResources() = default;
+
+CosmeticResources::CosmeticResources(CosmeticResources&& other) = default;
+
+CosmeticResources& CosmeticResources::operator=(CosmeticResources&& other) =
+    default;
+
+CosmeticResources::~CosmeticResources() = default;
+
+// static
+base::Optional<CosmeticResources> CosmeticResources::FromJSON(
+    base::StringPiece json) {
+  base::Optional<base::Value> value = base::JSONReader::Read(json);
+  if (!value || !value->is_dict())
+    return base::nullopt;
+
+  CosmeticResources resources;
+  TakeStrings(value->FindListKey("hide_selectors"), &resources.hide_selectors);
+  base::Value* style_selectors = value->FindDictKey("style_selectors");
+  if (style_selectors) {
+    for (auto item : style_selectors->DictItems())
+      TakeStrings(&item.second, &resources.style_selectors[item.first]);
+  }
+  TakeStrings(value->FindListKey("exceptions"), &resources.exceptions);
+  std::string* injected_script = value->FindStringKey("injected_script");
+  if (injected_script)
+    resources.injected_script = std::move(*injected_script);
+  resources.generichide = value->FindBoolKey("generichide").value_or(false);
+  base::Value* force_hide_selectors =
+      value->FindListKey("force_hide_selectors");
+  if (force_hide_selectors) {
+    resources.force_hide_selectors.emplace();
+    TakeStrings(force_hide_selectors, &*resources.force_hide_selectors);
+  }
+  return resources;
+}
+
+base::Value CosmeticResources::TakeValue() {
+  base::Value value(base::Value::Type::DICTIONARY);
+  value.SetKey("hide_selectors", ToListValue(&hide_selectors));
+  base::Value style_selectors_value(base::Value::Type::DICTIONARY);
+  for (auto& item : style_selectors)
+    style_selectors_value.SetKey(item.first, ToListValue(&item.second));
+  style_selectors.clear();
+  value.SetKey("style_selectors", std::move(style_selectors_value));
+  value.SetKey("exceptions", ToListValue(&exceptions));
+  value.SetStringKey("injected_script", std::move(injected_script));
+  injected_script.clear();
+  value.SetBoolKey("generichide", generichide);
+  if (force_hide_selectors) {
+    value.SetKey("force_hide_selectors",
+                 ToListValue(&*force_hide_selectors));
+    force_hide_selectors.reset();
+  }
+  return value;
+}
+
+std::vector<std::string> HiddenClassIdSelectorsFromJSON(
+    base::StringPiece json) {
+  std::vector<std::string> selectors;
+  base::Optional<base::Value> value = base::JSONReader::Read(json);
+  TakeStrings(value ? &*value : nullptr, &selectors);
+  return selectors;
+}
+
+}  // namespace brave_shields
@@ -0,0 +1,56 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_COSMETIC_RESOURCES_H_
+#define BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_COSMETIC_RESOURCES_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/optional.h"
+#include "base/strings/string_piece.h"
+#include "base/values.h"
+
+namespace brave_shields {
+
+// URL-specific cosmetic filtering resources of one or more engines. Engines
+// hand them over as JSON, which is parsed once into this structure; results
+// of the default, regional and custom engines are then merged by moving
+// strings, and only the final merged result is turned into a base::Value to
+// be sent to the renderer.
+struct CosmeticResources {
+  CosmeticResources();
+  CosmeticResources(CosmeticResources&& other);
+  CosmeticResources& operator=(CosmeticResources&& other);
+  ~CosmeticResources();
+
+  // Parses the JSON returned by adblock::Engine::urlCosmeticResources.
+  // Returns base::nullopt if |json| is not a dictionary.
+  static base::Optional<CosmeticResources> FromJSON(base::StringPiece json);
+
+  // Moves the resources into a dictionary laid out as the
+  // braveShields.urlCosmeticResources result, leaving this object empty.
+  base::Value TakeValue();
+
+  std::vector<std::string> hide_selectors;
+  std::map<std::string, std::vector<std::string>> style_selectors;
+  std::vector<std::string> exceptions;
+  std::string injected_script;
+  bool generichide = false;
+  // Only set once resources of the custom filters engine are merged in.
+  base::Optional<std::vector<std::string>> force_hide_selectors;
+
+  DISALLOW_COPY_AND_ASSIGN(CosmeticResources);
+};
+
+// Parses the JSON list returned by adblock::Engine::hiddenClassIdSelectors.
+std::vector<std::string> HiddenClassIdSelectorsFromJSON(
+    base::StringPiece json);
+
+}  // namespace brave_shields
+
+#endif  // BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_COSMETIC_RESOURCES_H_
@@ -0,0 +1,91 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/hidden_class_id_sessions.h"
+
+#include <algorithm>
+
+#include "base/hash/hash.h"
+
+namespace brave_shields {
+
+namespace {
+
+// Drops the tokens of |tokens| that are in |sent|, if any, or repeated
+// within |tokens|.
+void FilterSent(const std::unordered_set<std::string>* sent,
+                std::vector<std::string>* tokens) {
+  std::unordered_set<std::string> kept;
+  tokens->erase(std::remove_if(tokens->begin(), tokens->end(),
+                               [sent, &kept](const std::string& token) {
+                                 return (sent && sent->count(token)) ||
+                                        !kept.insert(token).second;
+                               }),
+                tokens->end());
+}
+
+}  // namespace
+
+HiddenClassIdSessions::Session::Session() = default;
+
+HiddenClassIdSessions::Session::~Session() = default;
+
+size_t HiddenClassIdSessions::FrameKeyHash::operator()(
+    const FrameKey& key) const {
+  return base::HashInts(key.first, key.second);
+}
+
+HiddenClassIdSessions::HiddenClassIdSessions(size_t max_frames)
+    : frames_(max_frames) {
+  DETACH_FROM_SEQUENCE(sequence_checker_);
+}
+
+HiddenClassIdSessions::~HiddenClassIdSessions() = default;
+
+void HiddenClassIdSessions::FilterNewTokens(
+    int tab_id,
+    int frame_id,
+    std::vector<std::string>* classes,
+    std::vector<std::string>* ids) const {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  auto it = frames_.Peek(FrameKey(tab_id, frame_id));
+  const Session* session = it != frames_.end() ? it->second.get() : nullptr;
+  FilterSent(session ? &session->classes : nullptr, classes);
+  FilterSent(session ? &session->ids : nullptr, ids);
+}
+
+void HiddenClassIdSessions::MarkSent(int tab_id,
+                                     int frame_id,
+                                     const std::vector<std::string>& classes,
+                                     const std::vector<std::string>& ids) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  const FrameKey key(tab_id, frame_id);
+  auto it = frames_.Get(key);
+  if (it == frames_.end())
+    it = frames_.Put(key, std::make_unique<Session>());
+
+  it->second->classes.insert(classes.begin(), classes.end());
+  it->second->ids.insert(ids.begin(), ids.end());
+}
+
+void HiddenClassIdSessions::ResetFrame(int tab_id, int frame_id) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  auto it = frames_.Peek(FrameKey(tab_id, frame_id));
+  if (it != frames_.end())
+    frames_.Erase(it);
+}
+
+void HiddenClassIdSessions::ResetTab(int tab_id) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  auto it = frames_.begin();
+  while (it != frames_.end()) {
+    if (it->first.first == tab_id)
+      it = frames_.Erase(it);
+    else
+      ++it;
+  }
+}
+
+}  // namespace brave_shields
@@ -0,0 +1,81 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HIDDEN_CLASS_ID_SESSIONS_H_
+#define BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HIDDEN_CLASS_ID_SESSIONS_H_
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "base/containers/mru_cache.h"
+#include "base/macros.h"
+#include "base/sequence_checker.h"
+
+namespace brave_shields {
+
+// Remembers, per document, the class and id tokens whose hidden selectors
+// have already been sent to it. Pages that keep mutating their DOM report
+// the same tokens over and over, only tokens never sent to the frame need to
+// be matched against the engines again. Frames are identified the way the
+// extension API does, by tab id and frame id (0 for the main frame), and
+// their session must be reset whenever a new document commits in them or a
+// new content script is loaded into them.
+//
+// Tokens are only remembered once their selectors have been handed back, so
+// a query that never got its reply is matched again the next time.
+//
+// Not thread safe, must be used on the adblock task runner.
+class HiddenClassIdSessions {
+ public:
+  explicit HiddenClassIdSessions(size_t max_frames);
+  ~HiddenClassIdSessions();
+
+  // Removes from |classes| and |ids| the tokens already sent to the frame and
+  // the repeated ones.
+  void FilterNewTokens(int tab_id,
+                       int frame_id,
+                       std::vector<std::string>* classes,
+                       std::vector<std::string>* ids) const;
+  // Remembers that the selectors of |classes| and |ids| were sent to the
+  // frame.
+  void MarkSent(int tab_id,
+                int frame_id,
+                const std::vector<std::string>& classes,
+                const std::vector<std::string>& ids);
+
+  void ResetFrame(int tab_id, int frame_id);
+  // Resets the main frame and every subframe of |tab_id|.
+  void ResetTab(int tab_id);
+
+  size_t frame_count() const { return frames_.size(); }
+
+ private:
+  struct Session {
+    Session();
+    ~Session();
+
+    std::unordered_set<std::string> classes;
+    std::unordered_set<std::string> ids;
+  };
+
+  using FrameKey = std::pair<int, int>;
+  struct FrameKeyHash {
+    size_t operator()(const FrameKey& key) const;
+  };
+
+  base::HashingMRUCache<FrameKey, std::unique_ptr<Session>, FrameKeyHash>
+      frames_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+
+  DISALLOW_COPY_AND_ASSIGN(HiddenClassIdSessions);
+};
+
+}  // namespace brave_shields
+
+#endif  // BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HIDDEN_CLASS_ID_SESSIONS_H_
@@ -0,0 +1,118 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/hidden_class_id_sessions.h"
+
+#include <string>
+#include <vector>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+using brave_shields::HiddenClassIdSessions;
+
+using Tokens = std::vector<std::string>;
+
+namespace {
+
+// Filters the tokens like a query would, and marks the remaining ones as
+// sent like its reply would.
+void Query(HiddenClassIdSessions* sessions,
+           int tab_id,
+           int frame_id,
+           Tokens* classes,
+           Tokens* ids) {
+  sessions->FilterNewTokens(tab_id, frame_id, classes, ids);
+  sessions->MarkSent(tab_id, frame_id, *classes, *ids);
+}
+
+}  // namespace
+
+TEST(HiddenClassIdSessionsTest, OnlyNewTokensAreKept) {
+  HiddenClassIdSessions sessions(10);
+  Tokens classes = {"a", "b", "a"};
+  Tokens ids = {"x"};
+  Query(&sessions, 1, 0, &classes, &ids);
+  EXPECT_EQ(Tokens({"a", "b"}), classes);
+  EXPECT_EQ(Tokens({"x"}), ids);
+
+  // Classes and ids are tracked separately.
+  classes = {"b", "c", "x"};
+  ids = {"x", "a"};
+  Query(&sessions, 1, 0, &classes, &ids);
+  EXPECT_EQ(Tokens({"c", "x"}), classes);
+  EXPECT_EQ(Tokens({"a"}), ids);
+}
+
+TEST(HiddenClassIdSessionsTest, TokensAreKeptUntilSent) {
+  HiddenClassIdSessions sessions(10);
+  Tokens classes = {"a", "a"};
+  Tokens ids = {"x"};
+  sessions.FilterNewTokens(1, 0, &classes, &ids);
+  EXPECT_EQ(Tokens({"a"}), classes);
+  EXPECT_EQ(0u, sessions.frame_count());
+
+  // The first reply never made it back, so the tokens are matched again.
+  classes = {"a"};
+  ids = {"x"};
+  sessions.FilterNewTokens(1, 0, &classes, &ids);
+  EXPECT_EQ(Tokens({"a"}), classes);
+  EXPECT_EQ(Tokens({"x"}), ids);
+
+  sessions.MarkSent(1, 0, classes, ids);
+  sessions.FilterNewTokens(1, 0, &classes, &ids);
+  EXPECT_TRUE(classes.empty());
+  EXPECT_TRUE(ids.empty());
+}
+
+TEST(HiddenClassIdSessionsTest, FramesAreIndependent) {
+  HiddenClassIdSessions sessions(10);
+  Tokens classes = {"a"};
+  Tokens ids;
+  Query(&sessions, 1, 0, &classes, &ids);
+
+  classes = {"a"};
+  Query(&sessions, 1, 5, &classes, &ids);
+  EXPECT_EQ(Tokens({"a"}), classes);
+
+  classes = {"a"};
+  Query(&sessions, 2, 0, &classes, &ids);
+  EXPECT_EQ(Tokens({"a"}), classes);
+}
+
+TEST(HiddenClassIdSessionsTest, Reset) {
+  HiddenClassIdSessions sessions(10);
+  Tokens classes = {"a"};
+  Tokens ids;
+  Query(&sessions, 1, 0, &classes, &ids);
+  classes = {"a"};
+  Query(&sessions, 1, 5, &classes, &ids);
+  classes = {"a"};
+  Query(&sessions, 2, 0, &classes, &ids);
+  EXPECT_EQ(3u, sessions.frame_count());
+
+  sessions.ResetFrame(1, 5);
+  EXPECT_EQ(2u, sessions.frame_count());
+  classes = {"a"};
+  Query(&sessions, 1, 5, &classes, &ids);
+  EXPECT_EQ(Tokens({"a"}), classes);
+
+  // Resetting a tab drops the sessions of all its frames.
+  sessions.ResetTab(1);
+  EXPECT_EQ(1u, sessions.frame_count());
+  classes = {"a"};
+  Query(&sessions, 1, 0, &classes, &ids);
+  EXPECT_EQ(Tokens({"a"}), classes);
+}
+
+TEST(HiddenClassIdSessionsTest, IsBounded) {
+  HiddenClassIdSessions sessions(2);
+  Tokens classes;
+  Tokens ids;
+  for (int tab_id = 0; tab_id < 5; ++tab_id) {
+    classes = {"a"};
+    Query(&sessions, tab_id, 0, &classes, &ids);
+  }
+  EXPECT_EQ(2u, sessions.frame_count());
+}
@@ -6,40 +6,156 @@
 #ifndef BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_RECENTLY_USED_CACHE_H_
 #define BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_RECENTLY_USED_CACHE_H_
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "base/containers/mru_cache.h"
+#include "base/macros.h"
+#include "base/metrics/histogram_functions.h"
 #include "base/synchronization/lock.h"
 
+// Caches HTTPS Everywhere results. Entries are spread over independently
+// locked shards chosen by host so concurrent lookups for different hosts do
+// not contend. Rewrites depend on the whole URL and are kept per URL, while
+// hosts that have no rules at all are remembered in a separate negative cache
+// so every URL on them is answered without a lookup.
 template <class T> class HTTPSERecentlyUsedCache {
  public:
-  explicit HTTPSERecentlyUsedCache(size_t size = 100) : data_(size) {}
+  explicit HTTPSERecentlyUsedCache(size_t size = 100,
+                                   size_t negative_size = 100,
+                                   size_t shard_count = 8)
+      : hits_(0), negative_hits_(0), misses_(0), evictions_(0) {
+    shard_count = std::max<size_t>(shard_count, 1);
+    for (size_t i = 0; i < shard_count; ++i) {
+      shards_.push_back(std::make_unique<Shard>(
+          std::max<size_t>(size / shard_count, 1),
+          std::max<size_t>(negative_size / shard_count, 1)));
+    }
+  }
 
-  void add(const std::string& key, const T& value) {
-    base::AutoLock create(lock_);
-    data_.Put(key, value);
+  void add(const std::string& host, const std::string& key, const T& value) {
+    Shard* shard = GetShard(host);
+    base::AutoLock lock(shard->lock);
+    auto no_rules_it = shard->no_rules_hosts.Peek(host);
+    if (no_rules_it != shard->no_rules_hosts.end())
+      shard->no_rules_hosts.Erase(no_rules_it);
+    if (shard->data.Peek(key) == shard->data.end() &&
+        shard->data.size() == shard->data.max_size()) {
+      evictions_++;
+    }
+    shard->data.Put(key, value);
   }
 
-  bool get(const std::string& key, T* value) {
-    base::AutoLock create(lock_);
-    auto it = data_.Get(key);
-    if (it != data_.end()) {
-      *value = it->second;
-      return true;
+  bool get(const std::string& host, const std::string& key, T* value) {
+    Shard* shard = GetShard(host);
+    bool found = false;
+    {
+      base::AutoLock lock(shard->lock);
+      auto it = shard->data.Get(key);
+      if (it != shard->data.end()) {
+        *value = it->second;
+        found = true;
+      }
     }
-    return false;
+    if (found)
+      hits_++;
+    else
+      misses_++;
+    MaybeReportMetrics();
+    return found;
   }
 
-  void remove(const std::string& key) {
-    base::AutoLock lock(lock_);
-    auto it = data_.Peek(key);
-    if (it != data_.end())
-      data_.Erase(it);
+  void remove(const std::string& host, const std::string& key) {
+    Shard* shard = GetShard(host);
+    base::AutoLock lock(shard->lock);
+    auto it = shard->data.Peek(key);
+    if (it != shard->data.end())
+      shard->data.Erase(it);
+  }
+
+  // Remembers that |host| has no rules, so none of its URLs can be rewritten.
+  void add_no_rules_host(const std::string& host) {
+    Shard* shard = GetShard(host);
+    base::AutoLock lock(shard->lock);
+    shard->no_rules_hosts.Put(host, true);
+  }
+
+  bool is_no_rules_host(const std::string& host) {
+    Shard* shard = GetShard(host);
+    bool found = false;
+    {
+      base::AutoLock lock(shard->lock);
+      found = shard->no_rules_hosts.Get(host) != shard->no_rules_hosts.end();
+    }
+    if (found) {
+      negative_hits_++;
+      MaybeReportMetrics();
+    }
+    return found;
+  }
+
+  void clear() {
+    for (auto& shard : shards_) {
+      base::AutoLock lock(shard->lock);
+      shard->data.Clear();
+      shard->no_rules_hosts.Clear();
+    }
   }
 
  private:
-  base::MRUCache<std::string, T> data_;
-  base::Lock lock_;
+  // Lookups between two reports of the cache metrics.
+  static const uint64_t kMetricsInterval = 1000;
+
+  struct Shard {
+    Shard(size_t size, size_t negative_size)
+        : data(size), no_rules_hosts(negative_size) {}
+
+    base::Lock lock;
+    base::HashingMRUCache<std::string, T> data;
+    base::HashingMRUCache<std::string, bool> no_rules_hosts;
+  };
+
+  Shard* GetShard(const std::string& host) {
+    return shards_[std::hash<std::string>()(host) % shards_.size()].get();
+  }
+
+  void MaybeReportMetrics() {
+    uint64_t hits = hits_.load();
+    uint64_t negative_hits = negative_hits_.load();
+    uint64_t misses = misses_.load();
+    uint64_t lookups = hits + negative_hits + misses;
+    if (lookups < kMetricsInterval)
+      return;
+    // Only the thread that resets the counters reports them.
+    if (!misses_.compare_exchange_strong(misses, 0))
+      return;
+    hits_ -= hits;
+    negative_hits_ -= negative_hits;
+    uint64_t evictions = evictions_.exchange(0);
+
+    base::UmaHistogramPercentage(
+        "Brave.HTTPSE.Cache.HitRate",
+        static_cast<int>(100 * (hits + negative_hits) / lookups));
+    base::UmaHistogramPercentage(
+        "Brave.HTTPSE.Cache.NegativeHitRate",
+        static_cast<int>(100 * negative_hits / lookups));
+    base::UmaHistogramPercentage("Brave.HTTPSE.Cache.MissRate",
+                                 static_cast<int>(100 * misses / lookups));
+    base::UmaHistogramCounts1000("Brave.HTTPSE.Cache.Evictions",
+                                 static_cast<int>(evictions));
+  }
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> negative_hits_;
+  std::atomic<uint64_t> misses_;
+  std::atomic<uint64_t> evictions_;
+
+  DISALLOW_COPY_AND_ASSIGN(HTTPSERecentlyUsedCache);
 };
 
 #endif  // BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_RECENTLY_USED_CACHE_H_
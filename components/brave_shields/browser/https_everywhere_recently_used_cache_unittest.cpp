@@ -10,21 +10,62 @@
 
 TEST(HTTPSEverywhereRecentlyUsedCacheTest, Operations) {
   using Cache = HTTPSERecentlyUsedCache<std::string>;
-  Cache cache(3);
+  Cache cache(3, 3, 1);
 
   // Test add/get and check that max size is maintained.
-  cache.add("kA", "vA");
-  cache.add("kB", "vB");
-  cache.add("kC", "vC");
+  cache.add("h", "kA", "vA");
+  cache.add("h", "kB", "vB");
+  cache.add("h", "kC", "vC");
   std::string v;
-  ASSERT_TRUE(cache.get("kA", &v));
+  ASSERT_TRUE(cache.get("h", "kA", &v));
   ASSERT_STREQ(v.c_str(), "vA");
   // kA just became MRU, so adding a new k/v pair should evict the oldest.
-  cache.add("kD", "vD");
-  ASSERT_FALSE(cache.get("kB", &v));
-  ASSERT_TRUE(cache.get("kD", &v));
+  cache.add("h", "kD", "vD");
+  ASSERT_FALSE(cache.get("h", "kB", &v));
+  ASSERT_TRUE(cache.get("h", "kD", &v));
 
   // Test remove.
-  cache.remove("kD");
-  ASSERT_FALSE(cache.get("kD", &v));
+  cache.remove("h", "kD");
+  ASSERT_FALSE(cache.get("h", "kD", &v));
+}
+
+TEST(HTTPSEverywhereRecentlyUsedCacheTest, NoRulesHosts) {
+  using Cache = HTTPSERecentlyUsedCache<std::string>;
+  Cache cache(4, 2, 1);
+
+  cache.add_no_rules_host("a.com");
+  cache.add_no_rules_host("b.com");
+  ASSERT_TRUE(cache.is_no_rules_host("a.com"));
+  ASSERT_TRUE(cache.is_no_rules_host("b.com"));
+  ASSERT_FALSE(cache.is_no_rules_host("c.com"));
+
+  // The negative cache has its own capacity.
+  cache.add_no_rules_host("c.com");
+  ASSERT_FALSE(cache.is_no_rules_host("a.com"));
+  ASSERT_TRUE(cache.is_no_rules_host("c.com"));
+
+  // A rewrite for a host drops its negative entry.
+  cache.add("c.com", "http://c.com/", "https://c.com/");
+  ASSERT_FALSE(cache.is_no_rules_host("c.com"));
+
+  cache.clear();
+  std::string v;
+  ASSERT_FALSE(cache.get("c.com", "http://c.com/", &v));
+  ASSERT_FALSE(cache.is_no_rules_host("b.com"));
+}
+
+TEST(HTTPSEverywhereRecentlyUsedCacheTest, Shards) {
+  using Cache = HTTPSERecentlyUsedCache<std::string>;
+  Cache cache(64, 64, 8);
+
+  for (int i = 0; i < 8; ++i) {
+    const std::string host = "host" + std::to_string(i) + ".com";
+    cache.add(host, "http://" + host + "/", "https://" + host + "/");
+  }
+  for (int i = 0; i < 8; ++i) {
+    const std::string host = "host" + std::to_string(i) + ".com";
+    std::string v;
+    ASSERT_TRUE(cache.get(host, "http://" + host + "/", &v));
+    ASSERT_EQ("https://" + host + "/", v);
+  }
 }
@@ -0,0 +1,59 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/https_everywhere_redirect_tracker.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+
+namespace brave_shields {
+
+HTTPSERedirectTracker::HTTPSERedirectTracker(size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1)), next_(0) {
+  ring_.reserve(capacity_);
+  index_.reserve(capacity_);
+}
+
+HTTPSERedirectTracker::~HTTPSERedirectTracker() = default;
+
+unsigned int HTTPSERedirectTracker::GetRedirects(
+    uint64_t request_identifier) {
+  base::AutoLock auto_lock(lock_);
+  auto it = index_.find(request_identifier);
+  if (it == index_.end())
+    return 0;
+  return ring_[it->second].redirects_;
+}
+
+void HTTPSERedirectTracker::AddRedirect(uint64_t request_identifier) {
+  base::AutoLock auto_lock(lock_);
+  auto it = index_.find(request_identifier);
+  if (it != index_.end()) {
+    ring_[it->second].redirects_++;
+    return;
+  }
+
+  if (ring_.size() < capacity_) {
+    index_[request_identifier] = ring_.size();
+    ring_.emplace_back(request_identifier, 1);
+    return;
+  }
+
+  // The ring is full, replace the oldest request.
+  HTTPSE_REDIRECTS_COUNT_ST& slot = ring_[next_];
+  index_.erase(slot.request_identifier_);
+  slot = HTTPSE_REDIRECTS_COUNT_ST(request_identifier, 1);
+  index_[request_identifier] = next_;
+  next_ = (next_ + 1) % capacity_;
+}
+
+size_t HTTPSERedirectTracker::size() {
+  base::AutoLock auto_lock(lock_);
+  DCHECK_EQ(ring_.size(), index_.size());
+  return index_.size();
+}
+
+}  // namespace brave_shields
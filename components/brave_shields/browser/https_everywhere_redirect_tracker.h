@@ -0,0 +1,62 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_REDIRECT_TRACKER_H_
+#define BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_REDIRECT_TRACKER_H_
+
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/synchronization/lock.h"
+
+namespace brave_shields {
+
+struct HTTPSE_REDIRECTS_COUNT_ST {
+ public:
+  HTTPSE_REDIRECTS_COUNT_ST(uint64_t request_identifier,
+                            unsigned int redirects):
+    request_identifier_(request_identifier),
+    redirects_(redirects) {
+  }
+
+  uint64_t request_identifier_;
+  unsigned int redirects_;
+};
+
+// Counts the HTTPS Everywhere redirects applied to each request so redirect
+// loops can be broken. Entries live in a fixed size ring indexed by a hash
+// map, so checking, incrementing and evicting the oldest request are all
+// constant time and the lock is only held for a handful of operations.
+class HTTPSERedirectTracker {
+ public:
+  explicit HTTPSERedirectTracker(size_t capacity);
+  ~HTTPSERedirectTracker();
+
+  // Returns the number of redirects recorded for |request_identifier|.
+  unsigned int GetRedirects(uint64_t request_identifier);
+
+  // Records one more redirect for |request_identifier|. When the ring is
+  // full the least recently added request is forgotten.
+  void AddRedirect(uint64_t request_identifier);
+
+  size_t size();
+
+ private:
+  const size_t capacity_;
+  base::Lock lock_;
+  std::vector<HTTPSE_REDIRECTS_COUNT_ST> ring_;
+  // Position in |ring_| that gets overwritten by the next new request.
+  size_t next_;
+  std::unordered_map<uint64_t, size_t> index_;
+
+  DISALLOW_COPY_AND_ASSIGN(HTTPSERedirectTracker);
+};
+
+}  // namespace brave_shields
+
+#endif  // BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_REDIRECT_TRACKER_H_
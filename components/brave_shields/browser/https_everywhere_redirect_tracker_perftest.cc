@@ -0,0 +1,39 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/https_everywhere_redirect_tracker.h"
+
+#include "base/timer/elapsed_timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+using brave_shields::HTTPSERedirectTracker;
+
+TEST(HTTPSEverywhereRedirectTrackerPerfTest, InterleavedRequests) {
+  const uint64_t kCapacity = 1000;
+  const uint64_t kRequests = 10000;
+  const int kRedirectsPerRequest = 4;
+  HTTPSERedirectTracker tracker(kCapacity);
+
+  // Interleave the requests as if they were all in flight at once, which
+  // continuously evicts the oldest ones.
+  base::ElapsedTimer timer;
+  for (int redirect = 0; redirect < kRedirectsPerRequest; ++redirect) {
+    for (uint64_t id = 1; id <= kRequests; ++id) {
+      if (tracker.GetRedirects(id) < 4u)
+        tracker.AddRedirect(id);
+    }
+  }
+  base::TimeDelta elapsed = timer.Elapsed();
+
+  EXPECT_EQ(kCapacity, tracker.size());
+  EXPECT_EQ(1u, tracker.GetRedirects(kRequests));
+
+  perf_test::PerfResultReporter reporter("HTTPSEverywhereRedirectTracker",
+                                         "interleaved_requests");
+  reporter.RegisterImportantMetric(".check_and_add", "us");
+  reporter.AddResult(".check_and_add",
+                     elapsed / (kRequests * kRedirectsPerRequest));
+}
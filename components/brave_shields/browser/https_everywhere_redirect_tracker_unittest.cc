@@ -0,0 +1,64 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/https_everywhere_redirect_tracker.h"
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+using brave_shields::HTTPSERedirectTracker;
+
+TEST(HTTPSEverywhereRedirectTrackerTest, CountsRedirects) {
+  HTTPSERedirectTracker tracker(3);
+  EXPECT_EQ(0u, tracker.GetRedirects(1));
+
+  tracker.AddRedirect(1);
+  tracker.AddRedirect(1);
+  tracker.AddRedirect(2);
+  EXPECT_EQ(2u, tracker.GetRedirects(1));
+  EXPECT_EQ(1u, tracker.GetRedirects(2));
+  EXPECT_EQ(2u, tracker.size());
+}
+
+TEST(HTTPSEverywhereRedirectTrackerTest, EvictsOldest) {
+  HTTPSERedirectTracker tracker(3);
+  tracker.AddRedirect(1);
+  tracker.AddRedirect(2);
+  tracker.AddRedirect(3);
+  // Incrementing does not refresh the position of a request in the ring.
+  tracker.AddRedirect(1);
+
+  tracker.AddRedirect(4);
+  EXPECT_EQ(3u, tracker.size());
+  EXPECT_EQ(0u, tracker.GetRedirects(1));
+  EXPECT_EQ(1u, tracker.GetRedirects(2));
+  EXPECT_EQ(1u, tracker.GetRedirects(4));
+
+  tracker.AddRedirect(5);
+  tracker.AddRedirect(6);
+  EXPECT_EQ(0u, tracker.GetRedirects(2));
+  EXPECT_EQ(0u, tracker.GetRedirects(3));
+  EXPECT_EQ(1u, tracker.GetRedirects(4));
+  EXPECT_EQ(1u, tracker.GetRedirects(6));
+}
+
+TEST(HTTPSEverywhereRedirectTrackerTest, StaysBoundedUnderInterleavedRequests) {
+  const uint64_t kCapacity = 10;
+  const uint64_t kRequests = 100;
+  const int kRedirectsPerRequest = 4;
+  HTTPSERedirectTracker tracker(kCapacity);
+
+  // Interleave the requests as if they were all in flight at once, which
+  // continuously evicts the oldest ones.
+  for (int redirect = 0; redirect < kRedirectsPerRequest; ++redirect) {
+    for (uint64_t id = 1; id <= kRequests; ++id) {
+      if (tracker.GetRedirects(id) < 4u)
+        tracker.AddRedirect(id);
+    }
+  }
+
+  EXPECT_EQ(kCapacity, tracker.size());
+  EXPECT_EQ(1u, tracker.GetRedirects(kRequests));
+  EXPECT_EQ(0u, tracker.GetRedirects(1));
+}
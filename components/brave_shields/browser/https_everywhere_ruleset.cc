@@ -0,0 +1,544 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/https_everywhere_ruleset.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/files/important_file_writer.h"
+#include "base/json/json_reader.h"
+#include "base/logging.h"
+#include "base/threading/scoped_blocking_call.h"
+#include "base/values.h"
+#include "third_party/leveldatabase/src/include/leveldb/db.h"
+#include "third_party/re2/src/re2/re2.h"
+#include "third_party/re2/src/re2/set.h"
+
+namespace brave_shields {
+
+namespace {
+
+// "HTSE" in little endian.
+const uint32_t kRulesetMagic = 0x45535448;
+// Bump whenever the layout below changes so stale files get rebuilt.
+const uint32_t kRulesetFormatVersion = 1;
+
+// Compiled targets kept in memory, which covers the sites of a typical
+// session without keeping every target ever visited.
+const size_t kMaxCompiledTargets = 1000;
+
+// Target flags.
+const uint32_t kTargetHasNoRules = 1 << 0;
+
+// Rule flags.
+const uint32_t kRuleIsDefault = 1 << 0;
+
+// File layout:
+//   RulesetHeader
+//   DomainEntry[domain_count]   sorted by key
+//   TargetEntry[target_count]
+//   StringRef[exclusion_count]
+//   RuleEntry[rule_count]
+//   char[strings_size]
+struct RulesetHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t domain_count;
+  uint32_t target_count;
+  uint32_t exclusion_count;
+  uint32_t rule_count;
+  uint32_t strings_size;
+};
+
+struct StringRef {
+  uint32_t offset;
+  uint32_t length;
+};
+
+struct DomainEntry {
+  StringRef key;
+  uint32_t first_target;
+  uint32_t target_count;
+};
+
+struct TargetEntry {
+  uint32_t first_exclusion;
+  uint32_t exclusion_count;
+  uint32_t first_rule;
+  uint32_t rule_count;
+  uint32_t flags;
+};
+
+struct RuleEntry {
+  StringRef from;
+  StringRef to;
+  uint32_t flags;
+};
+
+std::string CorrectToRuleToRE2Engine(const std::string& to) {
+  std::string corrected(to);
+  std::replace(corrected.begin(), corrected.end(), '$', '\\');
+  return corrected;
+}
+
+bool IsValidPattern(const std::string& pattern) {
+  RE2::Options options;
+  options.set_log_errors(false);
+  RE2 re(pattern, options);
+  return re.ok();
+}
+
+template <typename T>
+void AppendPod(const T& value, std::string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void AppendPodVector(const std::vector<T>& values, std::string* out) {
+  if (!values.empty()) {
+    out->append(reinterpret_cast<const char*>(values.data()),
+                values.size() * sizeof(T));
+  }
+}
+
+// Converts the JSON values stored in the leveldb into the flat tables of the
+// binary ruleset. Mirrors the semantics of
+// HTTPSEverywhereService::ApplyHTTPSRule so both paths rewrite URLs
+// identically.
+class RulesetBuilder {
+ public:
+  RulesetBuilder() = default;
+
+  void AddDomain(const std::string& domain, const std::string& value) {
+    uint32_t first_target = 0;
+    uint32_t target_count = 0;
+    auto it = targets_by_value_.find(value);
+    if (it != targets_by_value_.end()) {
+      first_target = it->second.first;
+      target_count = it->second.second;
+    } else {
+      first_target = static_cast<uint32_t>(targets_.size());
+      AddTargets(value);
+      target_count = static_cast<uint32_t>(targets_.size()) - first_target;
+      targets_by_value_[value] = std::make_pair(first_target, target_count);
+    }
+
+    if (target_count == 0)
+      return;
+
+    domains_.push_back({domain, first_target, target_count});
+  }
+
+  std::string Serialize() {
+    std::sort(domains_.begin(), domains_.end(),
+              [](const PendingDomain& a, const PendingDomain& b) {
+                return a.key < b.key;
+              });
+    std::vector<DomainEntry> domain_entries;
+    domain_entries.reserve(domains_.size());
+    for (const auto& domain : domains_) {
+      domain_entries.push_back(
+          {AddString(domain.key), domain.first_target, domain.target_count});
+    }
+
+    RulesetHeader header;
+    header.magic = kRulesetMagic;
+    header.version = kRulesetFormatVersion;
+    header.domain_count = static_cast<uint32_t>(domain_entries.size());
+    header.target_count = static_cast<uint32_t>(targets_.size());
+    header.exclusion_count = static_cast<uint32_t>(exclusions_.size());
+    header.rule_count = static_cast<uint32_t>(rules_.size());
+    header.strings_size = static_cast<uint32_t>(strings_.size());
+
+    std::string out;
+    AppendPod(header, &out);
+    AppendPodVector(domain_entries, &out);
+    AppendPodVector(targets_, &out);
+    AppendPodVector(exclusions_, &out);
+    AppendPodVector(rules_, &out);
+    out.append(strings_);
+    return out;
+  }
+
+ private:
+  struct PendingDomain {
+    std::string key;
+    uint32_t first_target;
+    uint32_t target_count;
+  };
+
+  StringRef AddString(const std::string& value) {
+    auto it = string_offsets_.find(value);
+    if (it != string_offsets_.end())
+      return {it->second, static_cast<uint32_t>(value.size())};
+
+    StringRef ref = {static_cast<uint32_t>(strings_.size()),
+                     static_cast<uint32_t>(value.size())};
+    strings_.append(value);
+    string_offsets_[value] = ref.offset;
+    return ref;
+  }
+
+  void AddTargets(const std::string& value) {
+    base::Optional<base::Value> json_object = base::JSONReader::Read(value);
+    if (!json_object || !json_object->is_list())
+      return;
+
+    for (const auto& target : json_object->GetList()) {
+      if (!target.is_dict())
+        continue;
+
+      TargetEntry entry = {};
+      entry.first_exclusion = static_cast<uint32_t>(exclusions_.size());
+      const base::Value* exclusions = target.FindListKey("e");
+      if (exclusions) {
+        for (const auto& exclusion : exclusions->GetList()) {
+          if (!exclusion.is_dict())
+            continue;
+          const std::string* pattern = exclusion.FindStringKey("p");
+          if (!pattern)
+            continue;
+          std::string corrected = CorrectToRuleToRE2Engine(*pattern);
+          if (!IsValidPattern(corrected))
+            continue;
+          exclusions_.push_back(AddString(corrected));
+        }
+      }
+      entry.exclusion_count =
+          static_cast<uint32_t>(exclusions_.size()) - entry.first_exclusion;
+
+      entry.first_rule = static_cast<uint32_t>(rules_.size());
+      const base::Value* rules = target.FindListKey("r");
+      if (!rules) {
+        entry.flags |= kTargetHasNoRules;
+      } else {
+        for (const auto& rule : rules->GetList()) {
+          if (!rule.is_dict())
+            continue;
+          if (rule.FindKey("d")) {
+            // Everything after the default rule is unreachable.
+            rules_.push_back({{0, 0}, {0, 0}, kRuleIsDefault});
+            break;
+          }
+          const std::string* from = rule.FindStringKey("f");
+          const std::string* to = rule.FindStringKey("t");
+          if (!from || !to || !IsValidPattern(*from))
+            continue;
+          rules_.push_back(
+              {AddString(*from), AddString(CorrectToRuleToRE2Engine(*to)), 0});
+        }
+      }
+      entry.rule_count =
+          static_cast<uint32_t>(rules_.size()) - entry.first_rule;
+      targets_.push_back(entry);
+    }
+  }
+
+  std::vector<PendingDomain> domains_;
+  std::vector<TargetEntry> targets_;
+  std::vector<StringRef> exclusions_;
+  std::vector<RuleEntry> rules_;
+  std::string strings_;
+  std::map<std::string, uint32_t> string_offsets_;
+  std::map<std::string, std::pair<uint32_t, uint32_t>> targets_by_value_;
+
+  DISALLOW_COPY_AND_ASSIGN(RulesetBuilder);
+};
+
+const RulesetHeader* GetHeader(const base::MemoryMappedFile& file) {
+  return reinterpret_cast<const RulesetHeader*>(file.data());
+}
+
+const DomainEntry* GetDomains(const base::MemoryMappedFile& file) {
+  return reinterpret_cast<const DomainEntry*>(file.data() +
+                                              sizeof(RulesetHeader));
+}
+
+const TargetEntry* GetTargets(const base::MemoryMappedFile& file) {
+  return reinterpret_cast<const TargetEntry*>(
+      GetDomains(file) + GetHeader(file)->domain_count);
+}
+
+const StringRef* GetExclusions(const base::MemoryMappedFile& file) {
+  return reinterpret_cast<const StringRef*>(
+      GetTargets(file) + GetHeader(file)->target_count);
+}
+
+const RuleEntry* GetRules(const base::MemoryMappedFile& file) {
+  return reinterpret_cast<const RuleEntry*>(
+      GetExclusions(file) + GetHeader(file)->exclusion_count);
+}
+
+const char* GetStrings(const base::MemoryMappedFile& file) {
+  return reinterpret_cast<const char*>(
+      GetRules(file) + GetHeader(file)->rule_count);
+}
+
+bool IsValidRange(uint64_t first, uint64_t count, uint64_t size) {
+  return first <= size && count <= size - first;
+}
+
+}  // namespace
+
+struct HTTPSEverywhereRuleset::CompiledTarget {
+  // Anchored on both ends to match RE2::FullMatch semantics.
+  std::unique_ptr<RE2::Set> exclusions;
+  // Unanchored to match RE2::Replace semantics.
+  std::unique_ptr<RE2::Set> rule_patterns;
+  // Maps an index of |rule_patterns| to the rule index within the target.
+  std::vector<uint32_t> rule_indices;
+  // One entry per rule of the target, null for the default rule.
+  std::vector<std::unique_ptr<RE2>> rules;
+};
+
+HTTPSEverywhereRuleset::HTTPSEverywhereRuleset()
+    : compiled_targets_(kMaxCompiledTargets) {}
+
+HTTPSEverywhereRuleset::~HTTPSEverywhereRuleset() = default;
+
+// static
+bool HTTPSEverywhereRuleset::Build(leveldb::DB* db,
+                                   const base::FilePath& path) {
+  base::ScopedBlockingCall scoped_blocking_call(FROM_HERE,
+                                                base::BlockingType::MAY_BLOCK);
+  if (!db)
+    return false;
+
+  RulesetBuilder builder;
+  std::unique_ptr<leveldb::Iterator> it(
+      db->NewIterator(leveldb::ReadOptions()));
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    builder.AddDomain(it->key().ToString(), it->value().ToString());
+  }
+  if (!it->status().ok()) {
+    LOG(ERROR) << "Failed to read HTTPSE database: "
+               << it->status().ToString();
+    return false;
+  }
+
+  return base::ImportantFileWriter::WriteFileAtomically(path,
+                                                        builder.Serialize());
+}
+
+// static
+std::unique_ptr<HTTPSEverywhereRuleset> HTTPSEverywhereRuleset::Load(
+    const base::FilePath& path) {
+  base::ScopedBlockingCall scoped_blocking_call(FROM_HERE,
+                                                base::BlockingType::MAY_BLOCK);
+  std::unique_ptr<HTTPSEverywhereRuleset> ruleset(new HTTPSEverywhereRuleset);
+  if (!ruleset->Initialize(path))
+    return nullptr;
+  return ruleset;
+}
+
+bool HTTPSEverywhereRuleset::Initialize(const base::FilePath& path) {
+  if (!file_.Initialize(path))
+    return false;
+
+  if (file_.length() < sizeof(RulesetHeader))
+    return false;
+
+  const RulesetHeader* header = GetHeader(file_);
+  if (header->magic != kRulesetMagic ||
+      header->version != kRulesetFormatVersion) {
+    return false;
+  }
+
+  const uint64_t expected_length =
+      sizeof(RulesetHeader) +
+      static_cast<uint64_t>(header->domain_count) * sizeof(DomainEntry) +
+      static_cast<uint64_t>(header->target_count) * sizeof(TargetEntry) +
+      static_cast<uint64_t>(header->exclusion_count) * sizeof(StringRef) +
+      static_cast<uint64_t>(header->rule_count) * sizeof(RuleEntry) +
+      header->strings_size;
+  if (file_.length() != expected_length)
+    return false;
+
+  // Validate every reference once so lookups never need bounds checks.
+  auto is_valid_string = [header](const StringRef& ref) {
+    return IsValidRange(ref.offset, ref.length, header->strings_size);
+  };
+  const DomainEntry* domains = GetDomains(file_);
+  for (uint32_t i = 0; i < header->domain_count; ++i) {
+    if (!is_valid_string(domains[i].key) ||
+        !IsValidRange(domains[i].first_target, domains[i].target_count,
+                      header->target_count)) {
+      return false;
+    }
+  }
+  const TargetEntry* targets = GetTargets(file_);
+  for (uint32_t i = 0; i < header->target_count; ++i) {
+    if (!IsValidRange(targets[i].first_exclusion, targets[i].exclusion_count,
+                      header->exclusion_count) ||
+        !IsValidRange(targets[i].first_rule, targets[i].rule_count,
+                      header->rule_count)) {
+      return false;
+    }
+  }
+  const StringRef* exclusions = GetExclusions(file_);
+  for (uint32_t i = 0; i < header->exclusion_count; ++i) {
+    if (!is_valid_string(exclusions[i]))
+      return false;
+  }
+  const RuleEntry* rules = GetRules(file_);
+  for (uint32_t i = 0; i < header->rule_count; ++i) {
+    if (!is_valid_string(rules[i].from) || !is_valid_string(rules[i].to))
+      return false;
+  }
+
+  return true;
+}
+
+size_t HTTPSEverywhereRuleset::domain_count() const {
+  return GetHeader(file_)->domain_count;
+}
+
+size_t HTTPSEverywhereRuleset::target_count() const {
+  return GetHeader(file_)->target_count;
+}
+
+base::StringPiece HTTPSEverywhereRuleset::GetString(uint32_t offset,
+                                                    uint32_t length) const {
+  return base::StringPiece(GetStrings(file_) + offset, length);
+}
+
+const HTTPSEverywhereRuleset::CompiledTarget&
+HTTPSEverywhereRuleset::GetCompiledTarget(uint32_t index) {
+  auto it = compiled_targets_.Get(index);
+  if (it != compiled_targets_.end())
+    return *it->second;
+
+  // Patterns were validated when the ruleset was built, so this is the only
+  // place they get compiled.
+  auto compiled = std::make_unique<CompiledTarget>();
+  const TargetEntry& target = GetTargets(file_)[index];
+  RE2::Options options;
+  options.set_log_errors(false);
+
+  if (target.exclusion_count > 0) {
+    compiled->exclusions =
+        std::make_unique<RE2::Set>(options, RE2::ANCHOR_BOTH);
+    const StringRef* exclusions =
+        GetExclusions(file_) + target.first_exclusion;
+    for (uint32_t i = 0; i < target.exclusion_count; ++i) {
+      compiled->exclusions->Add(
+          GetString(exclusions[i].offset, exclusions[i].length), nullptr);
+    }
+    if (!compiled->exclusions->Compile())
+      compiled->exclusions.reset();
+  }
+
+  compiled->rules.resize(target.rule_count);
+  const RuleEntry* rules = GetRules(file_) + target.first_rule;
+  for (uint32_t i = 0; i < target.rule_count; ++i) {
+    if (rules[i].flags & kRuleIsDefault)
+      continue;
+    base::StringPiece from = GetString(rules[i].from.offset,
+                                       rules[i].from.length);
+    compiled->rules[i] = std::make_unique<RE2>(
+        re2::StringPiece(from.data(), from.size()), options);
+    if (!compiled->rule_patterns) {
+      compiled->rule_patterns =
+          std::make_unique<RE2::Set>(options, RE2::UNANCHORED);
+    }
+    if (compiled->rule_patterns->Add(
+            re2::StringPiece(from.data(), from.size()), nullptr) >= 0) {
+      compiled->rule_indices.push_back(i);
+    }
+  }
+  if (compiled->rule_patterns && !compiled->rule_patterns->Compile()) {
+    compiled->rule_patterns.reset();
+    compiled->rule_indices.clear();
+  }
+
+  return *compiled_targets_.Put(index, std::move(compiled))->second;
+}
+
+bool HTTPSEverywhereRuleset::ApplyTarget(uint32_t index,
+                                         const std::string& url,
+                                         std::string* new_url) {
+  const TargetEntry& target = GetTargets(file_)[index];
+  const CompiledTarget& compiled = GetCompiledTarget(index);
+
+  if (compiled.exclusions && compiled.exclusions->Match(url, nullptr)) {
+    new_url->clear();
+    return true;
+  }
+
+  if (target.flags & kTargetHasNoRules) {
+    new_url->clear();
+    return true;
+  }
+
+  std::vector<bool> matched(target.rule_count, false);
+  if (compiled.rule_patterns) {
+    std::vector<int> matches;
+    if (compiled.rule_patterns->Match(url, &matches)) {
+      for (int match : matches)
+        matched[compiled.rule_indices[match]] = true;
+    }
+  }
+
+  const RuleEntry* rules = GetRules(file_) + target.first_rule;
+  for (uint32_t i = 0; i < target.rule_count; ++i) {
+    if (rules[i].flags & kRuleIsDefault) {
+      *new_url = url;
+      new_url->insert(4, "s");
+      return true;
+    }
+    if (!matched[i])
+      continue;
+    base::StringPiece to = GetString(rules[i].to.offset, rules[i].to.length);
+    std::string candidate(url);
+    if (RE2::Replace(&candidate, *compiled.rules[i],
+                     re2::StringPiece(to.data(), to.size())) &&
+        candidate != url) {
+      *new_url = std::move(candidate);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool HTTPSEverywhereRuleset::FindDomain(base::StringPiece domain,
+                                        uint32_t* index) const {
+  const DomainEntry* begin = GetDomains(file_);
+  const DomainEntry* end = begin + GetHeader(file_)->domain_count;
+  const DomainEntry* it = std::lower_bound(
+      begin, end, domain,
+      [this](const DomainEntry& entry, base::StringPiece key) {
+        return GetString(entry.key.offset, entry.key.length) < key;
+      });
+  if (it == end || GetString(it->key.offset, it->key.length) != domain)
+    return false;
+  *index = static_cast<uint32_t>(it - begin);
+  return true;
+}
+
+bool HTTPSEverywhereRuleset::HasRules(base::StringPiece domain) const {
+  uint32_t index = 0;
+  return FindDomain(domain, &index);
+}
+
+std::string HTTPSEverywhereRuleset::ApplyRules(base::StringPiece domain,
+                                               const std::string& url) {
+  uint32_t index = 0;
+  if (!FindDomain(domain, &index))
+    return std::string();
+
+  const DomainEntry& entry = GetDomains(file_)[index];
+  std::string new_url;
+  for (uint32_t i = 0; i < entry.target_count; ++i) {
+    if (ApplyTarget(entry.first_target + i, url, &new_url))
+      return new_url;
+  }
+  return std::string();
+}
+
+}  // namespace brave_shields
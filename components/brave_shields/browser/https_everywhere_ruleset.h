@@ -0,0 +1,87 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_RULESET_H_
+#define BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_RULESET_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "base/containers/mru_cache.h"
+#include "base/files/file_path.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/macros.h"
+#include "base/strings/string_piece.h"
+
+namespace leveldb {
+class DB;
+}
+
+namespace brave_shields {
+
+// Binary, memory-mapped form of the HTTPS Everywhere rules.
+//
+// The leveldb shipped with the component maps every lookup domain to a JSON
+// list of rulesets. Parsing that JSON and compiling its regular expressions
+// for every cache miss is expensive, so when the component is installed the
+// whole database is converted once into a flat file made of a sorted domain
+// index, a deduplicated target table and pre-validated patterns. Lookups
+// binary search the mapped index and match against RE2::Set objects compiled
+// for the most recently used targets, so a long session only keeps a bounded
+// number of them.
+//
+// Not thread safe, must be used on the HTTPS Everywhere task runner.
+class HTTPSEverywhereRuleset {
+ public:
+  ~HTTPSEverywhereRuleset();
+
+  // Converts every entry of |db| into the binary format and writes it to
+  // |path|. Returns false if the database could not be read or the file could
+  // not be written.
+  static bool Build(leveldb::DB* db, const base::FilePath& path);
+
+  // Maps the file at |path|. Returns nullptr if the file is missing, has been
+  // produced by a different format version or is malformed.
+  static std::unique_ptr<HTTPSEverywhereRuleset> Load(
+      const base::FilePath& path);
+
+  // Returns true if any rule is registered for the lookup key |domain|.
+  bool HasRules(base::StringPiece domain) const;
+
+  // Applies the rules registered for the lookup key |domain| (as produced by
+  // ExpandDomainForLookup) to |url|. Returns the rewritten URL, or an empty
+  // string if no rule applies.
+  std::string ApplyRules(base::StringPiece domain, const std::string& url);
+
+  size_t domain_count() const;
+  size_t target_count() const;
+
+ private:
+  struct CompiledTarget;
+
+  HTTPSEverywhereRuleset();
+
+  bool Initialize(const base::FilePath& path);
+  // Sets |index| to the position of |domain| in the domain index.
+  bool FindDomain(base::StringPiece domain, uint32_t* index) const;
+  base::StringPiece GetString(uint32_t offset, uint32_t length) const;
+  const CompiledTarget& GetCompiledTarget(uint32_t index);
+  // Returns true and sets |new_url| when the target decided the outcome of the
+  // lookup, either by rewriting |url| or by excluding it.
+  bool ApplyTarget(uint32_t index,
+                   const std::string& url,
+                   std::string* new_url);
+
+  base::MemoryMappedFile file_;
+  base::MRUCache<uint32_t, std::unique_ptr<CompiledTarget>> compiled_targets_;
+
+  DISALLOW_COPY_AND_ASSIGN(HTTPSEverywhereRuleset);
+};
+
+}  // namespace brave_shields
+
+#endif  // BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_RULESET_H_
@@ -0,0 +1,143 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/task_environment.h"
+#include "base/threading/sequenced_task_runner_handle.h"
+#include "base/timer/elapsed_timer.h"
+#include "brave/components/brave_shields/browser/https_everywhere_ruleset.h"
+#include "brave/components/brave_shields/browser/https_everywhere_service.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "third_party/leveldatabase/src/include/leveldb/db.h"
+
+using brave_shields::HTTPSEverywhereRuleset;
+using brave_shields::HTTPSEverywhereService;
+
+namespace {
+
+const int kDomainCount = 2000;
+const int kIterations = 20;
+
+class TestComponentDelegate : public BraveComponent::Delegate {
+ public:
+  TestComponentDelegate() = default;
+  ~TestComponentDelegate() override = default;
+
+  void Register(const std::string& component_name,
+                const std::string& component_base64_public_key,
+                base::OnceClosure registered_callback,
+                BraveComponent::ReadyCallback ready_callback) override {}
+  bool Unregister(const std::string& component_id) override { return true; }
+  void OnDemandUpdate(const std::string& component_id) override {}
+  scoped_refptr<base::SequencedTaskRunner> GetTaskRunner() override {
+    return base::SequencedTaskRunnerHandle::Get();
+  }
+};
+
+std::string GetRulesForDomain(int index) {
+  return base::StringPrintf(
+      "[{\"e\":[{\"p\":\"^http://example%d\\\\.com/excluded/\"}],"
+      "\"r\":[{\"f\":\"^http://example%d\\\\.com/secure/\","
+      "\"t\":\"https://example%d.com/secure/\"},"
+      "{\"f\":\"^http://(www\\\\.)?example%d\\\\.com/\","
+      "\"t\":\"https://www.example%d.com/\"}]}]",
+      index, index, index, index, index);
+}
+
+}  // namespace
+
+class HTTPSEverywhereRulesetPerfTest : public testing::Test {
+ public:
+  HTTPSEverywhereRulesetPerfTest() = default;
+  ~HTTPSEverywhereRulesetPerfTest() override = default;
+
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    service_ = std::make_unique<HTTPSEverywhereService>(&delegate_);
+
+    leveldb::Options options;
+    options.create_if_missing = true;
+    leveldb::DB* db = nullptr;
+    ASSERT_TRUE(leveldb::DB::Open(
+        options, temp_dir_.GetPath().AppendASCII("db").AsUTF8Unsafe(), &db)
+            .ok());
+    db_.reset(db);
+  }
+
+  void TearDown() override {
+    service_.reset();
+    task_environment_.RunUntilIdle();
+  }
+
+  // The pre-existing lookup path: leveldb Get, JSON parse and RE2 compile.
+  std::string ApplyLegacyRules(const std::string& domain,
+                               const std::string& url) {
+    std::string value;
+    if (!db_->Get(leveldb::ReadOptions(), domain, &value).ok())
+      return std::string();
+    return service_->ApplyHTTPSRule(url, value);
+  }
+
+ protected:
+  base::test::TaskEnvironment task_environment_;
+  base::ScopedTempDir temp_dir_;
+  TestComponentDelegate delegate_;
+  std::unique_ptr<HTTPSEverywhereService> service_;
+  std::unique_ptr<leveldb::DB> db_;
+};
+
+TEST_F(HTTPSEverywhereRulesetPerfTest, Lookup) {
+  for (int i = 0; i < kDomainCount; ++i) {
+    ASSERT_TRUE(db_->Put(leveldb::WriteOptions(),
+                         base::StringPrintf("com.example%d", i),
+                         GetRulesForDomain(i))
+                    .ok());
+  }
+
+  base::FilePath path = temp_dir_.GetPath().AppendASCII("httpse.ruleset");
+  ASSERT_TRUE(HTTPSEverywhereRuleset::Build(db_.get(), path));
+  std::unique_ptr<HTTPSEverywhereRuleset> ruleset =
+      HTTPSEverywhereRuleset::Load(path);
+  ASSERT_TRUE(ruleset);
+
+  std::vector<std::pair<std::string, std::string>> lookups;
+  for (int i = 0; i < kDomainCount; ++i) {
+    lookups.emplace_back(base::StringPrintf("com.example%d", i),
+                         base::StringPrintf("http://example%d.com/page", i));
+  }
+
+  base::ElapsedTimer legacy_timer;
+  for (int i = 0; i < kIterations; ++i) {
+    for (const auto& lookup : lookups)
+      ApplyLegacyRules(lookup.first, lookup.second);
+  }
+  base::TimeDelta legacy_time = legacy_timer.Elapsed();
+
+  base::ElapsedTimer ruleset_timer;
+  for (int i = 0; i < kIterations; ++i) {
+    for (const auto& lookup : lookups)
+      ruleset->ApplyRules(lookup.first, lookup.second);
+  }
+  base::TimeDelta ruleset_time = ruleset_timer.Elapsed();
+
+  for (const auto& lookup : lookups) {
+    ASSERT_EQ(ApplyLegacyRules(lookup.first, lookup.second),
+              ruleset->ApplyRules(lookup.first, lookup.second));
+  }
+
+  const int lookup_count = kDomainCount * kIterations;
+  perf_test::PerfResultReporter reporter("HTTPSEverywhereRuleset", "lookup");
+  reporter.RegisterImportantMetric(".leveldb_json", "us");
+  reporter.RegisterImportantMetric(".ruleset", "us");
+  reporter.AddResult(".leveldb_json", legacy_time / lookup_count);
+  reporter.AddResult(".ruleset", ruleset_time / lookup_count);
+}
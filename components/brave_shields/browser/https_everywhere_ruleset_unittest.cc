@@ -0,0 +1,163 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/task_environment.h"
+#include "base/threading/sequenced_task_runner_handle.h"
+#include "brave/components/brave_shields/browser/https_everywhere_ruleset.h"
+#include "brave/components/brave_shields/browser/https_everywhere_service.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/leveldatabase/src/include/leveldb/db.h"
+
+using brave_shields::HTTPSEverywhereRuleset;
+using brave_shields::HTTPSEverywhereService;
+
+namespace {
+
+class TestComponentDelegate : public BraveComponent::Delegate {
+ public:
+  TestComponentDelegate() = default;
+  ~TestComponentDelegate() override = default;
+
+  void Register(const std::string& component_name,
+                const std::string& component_base64_public_key,
+                base::OnceClosure registered_callback,
+                BraveComponent::ReadyCallback ready_callback) override {}
+  bool Unregister(const std::string& component_id) override { return true; }
+  void OnDemandUpdate(const std::string& component_id) override {}
+  scoped_refptr<base::SequencedTaskRunner> GetTaskRunner() override {
+    return base::SequencedTaskRunnerHandle::Get();
+  }
+};
+
+std::string GetRulesForDomain(int index) {
+  return base::StringPrintf(
+      "[{\"e\":[{\"p\":\"^http://example%d\\\\.com/excluded/\"}],"
+      "\"r\":[{\"f\":\"^http://example%d\\\\.com/secure/\","
+      "\"t\":\"https://example%d.com/secure/\"},"
+      "{\"f\":\"^http://(www\\\\.)?example%d\\\\.com/\","
+      "\"t\":\"https://www.example%d.com/\"}]}]",
+      index, index, index, index, index);
+}
+
+}  // namespace
+
+class HTTPSEverywhereRulesetTest : public testing::Test {
+ public:
+  HTTPSEverywhereRulesetTest() = default;
+  ~HTTPSEverywhereRulesetTest() override = default;
+
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    service_ = std::make_unique<HTTPSEverywhereService>(&delegate_);
+
+    leveldb::Options options;
+    options.create_if_missing = true;
+    leveldb::DB* db = nullptr;
+    ASSERT_TRUE(leveldb::DB::Open(
+        options, temp_dir_.GetPath().AppendASCII("db").AsUTF8Unsafe(), &db)
+            .ok());
+    db_.reset(db);
+  }
+
+  void TearDown() override {
+    service_.reset();
+    task_environment_.RunUntilIdle();
+  }
+
+  void PutRules(const std::string& domain, const std::string& rules) {
+    ASSERT_TRUE(db_->Put(leveldb::WriteOptions(), domain, rules).ok());
+  }
+
+  std::unique_ptr<HTTPSEverywhereRuleset> BuildRuleset() {
+    base::FilePath path = temp_dir_.GetPath().AppendASCII("httpse.ruleset");
+    if (!HTTPSEverywhereRuleset::Build(db_.get(), path))
+      return nullptr;
+    return HTTPSEverywhereRuleset::Load(path);
+  }
+
+  // The pre-existing lookup path: leveldb Get, JSON parse and RE2 compile.
+  std::string ApplyLegacyRules(const std::string& domain,
+                               const std::string& url) {
+    std::string value;
+    if (!db_->Get(leveldb::ReadOptions(), domain, &value).ok())
+      return std::string();
+    return service_->ApplyHTTPSRule(url, value);
+  }
+
+ protected:
+  base::test::TaskEnvironment task_environment_;
+  base::ScopedTempDir temp_dir_;
+  TestComponentDelegate delegate_;
+  std::unique_ptr<HTTPSEverywhereService> service_;
+  std::unique_ptr<leveldb::DB> db_;
+};
+
+TEST_F(HTTPSEverywhereRulesetTest, MatchesLegacyRules) {
+  PutRules("com.example1", GetRulesForDomain(1));
+  PutRules("com.default", "[{\"r\":[{\"d\":1}]}]");
+  PutRules("com.norules", "[{\"e\":[]}]");
+  PutRules("com.invalid", "[{\"r\":[{\"f\":\"(\",\"t\":\"https://x/\"}]}]");
+  PutRules("com.malformed", "not json");
+
+  std::unique_ptr<HTTPSEverywhereRuleset> ruleset = BuildRuleset();
+  ASSERT_TRUE(ruleset);
+  // The malformed entry has no target and is dropped from the index.
+  EXPECT_EQ(4u, ruleset->domain_count());
+
+  const std::vector<std::pair<std::string, std::string>> lookups = {
+      {"com.example1", "http://example1.com/"},
+      {"com.example1", "http://www.example1.com/page"},
+      {"com.example1", "http://example1.com/secure/login"},
+      {"com.example1", "http://example1.com/excluded/page"},
+      {"com.example1", "http://other.com/"},
+      {"com.default", "http://default.com/path?q=1"},
+      {"com.norules", "http://norules.com/"},
+      {"com.invalid", "http://invalid.com/"},
+      {"com.malformed", "http://malformed.com/"},
+      {"com.missing", "http://missing.com/"},
+  };
+  for (const auto& lookup : lookups) {
+    EXPECT_EQ(ApplyLegacyRules(lookup.first, lookup.second),
+              ruleset->ApplyRules(lookup.first, lookup.second))
+        << lookup.second;
+  }
+
+  EXPECT_EQ("https://www.example1.com/",
+            ruleset->ApplyRules("com.example1", "http://example1.com/"));
+  EXPECT_EQ("https://example1.com/secure/login",
+            ruleset->ApplyRules("com.example1",
+                                "http://example1.com/secure/login"));
+  EXPECT_EQ("", ruleset->ApplyRules("com.example1",
+                                    "http://example1.com/excluded/page"));
+  EXPECT_EQ("https://default.com/path?q=1",
+            ruleset->ApplyRules("com.default", "http://default.com/path?q=1"));
+}
+
+TEST_F(HTTPSEverywhereRulesetTest, SharesIdenticalTargets) {
+  const std::string rules = "[{\"r\":[{\"d\":1}]}]";
+  PutRules("com.a", rules);
+  PutRules("com.b", rules);
+  PutRules("com.c", rules);
+
+  std::unique_ptr<HTTPSEverywhereRuleset> ruleset = BuildRuleset();
+  ASSERT_TRUE(ruleset);
+  EXPECT_EQ(3u, ruleset->domain_count());
+  EXPECT_EQ(1u, ruleset->target_count());
+}
+
+TEST_F(HTTPSEverywhereRulesetTest, RejectsCorruptFile) {
+  base::FilePath path = temp_dir_.GetPath().AppendASCII("httpse.ruleset");
+  ASSERT_TRUE(base::WriteFile(path, "garbage"));
+  EXPECT_FALSE(HTTPSEverywhereRuleset::Load(path));
+  EXPECT_FALSE(HTTPSEverywhereRuleset::Load(
+      temp_dir_.GetPath().AppendASCII("missing.ruleset")));
+}
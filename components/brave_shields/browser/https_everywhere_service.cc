@@ -19,13 +19,16 @@
 #include "base/strings/utf_string_conversions.h"
 #include "base/threading/scoped_blocking_call.h"
 #include "base/values.h"
+#include "brave/components/brave_shields/browser/https_everywhere_ruleset.h"
+#include "brave/components/brave_shields/common/features.h"
 #include "third_party/leveldatabase/src/include/leveldb/db.h"
 #include "third_party/re2/src/re2/re2.h"
 #include "third_party/zlib/google/zip.h"
 
 #define DAT_FILE "httpse.leveldb.zip"
 #define DAT_FILE_VERSION "6.0"
-#define HTTPSE_URLS_REDIRECTS_COUNT_QUEUE   1
+#define RULESET_FILE "httpse.ruleset"
+#define HTTPSE_URLS_REDIRECTS_COUNT_QUEUE   1000
 #define HTTPSE_URL_MAX_REDIRECTS_COUNT      5
 
 namespace {
@@ -100,12 +103,19 @@ HTTPSEverywhereService::g_https_everywhere_component_base64_public_key_(
 HTTPSEverywhereService::HTTPSEverywhereService(
     BraveComponent::Delegate* delegate)
     : BaseBraveShieldsService(delegate),
+      redirect_tracker_(HTTPSE_URLS_REDIRECTS_COUNT_QUEUE),
+      recently_used_cache_(
+          features::kBraveHTTPSEverywhereCacheSize.Get(),
+          features::kBraveHTTPSEverywhereNegativeCacheSize.Get(),
+          features::kBraveHTTPSEverywhereCacheShards.Get()),
       level_db_(nullptr) {
   DETACH_FROM_SEQUENCE(sequence_checker_);
 }
 
 HTTPSEverywhereService::~HTTPSEverywhereService() {
   GetTaskRunner()->DeleteSoon(FROM_HERE, level_db_);
+  if (ruleset_)
+    GetTaskRunner()->DeleteSoon(FROM_HERE, std::move(ruleset_));
 }
 
 bool HTTPSEverywhereService::Init() {
@@ -121,6 +131,18 @@ void HTTPSEverywhereService::InitDB(const base::FilePath& install_dir) {
       install_dir.AppendASCII(DAT_FILE_VERSION).AppendASCII(DAT_FILE);
   base::FilePath unzipped_level_db_path = zip_db_file_path.RemoveExtension();
   base::FilePath destination = zip_db_file_path.DirName();
+
+  // Lookups are served from the precompiled ruleset. It is built next to the
+  // database the first time this version of the component is loaded, so later
+  // loads neither unzip nor open the database.
+  base::FilePath ruleset_path = destination.AppendASCII(RULESET_FILE);
+  std::unique_ptr<HTTPSEverywhereRuleset> ruleset =
+      HTTPSEverywhereRuleset::Load(ruleset_path);
+  if (ruleset) {
+    OnRulesetLoaded(std::move(ruleset));
+    return;
+  }
+
   if (!zip::Unzip(zip_db_file_path, destination)) {
     LOG(ERROR) << "Failed to unzip database file "
                << zip_db_file_path.value().c_str();
@@ -141,6 +163,26 @@ void HTTPSEverywhereService::InitDB(const base::FilePath& install_dir) {
     CloseDatabase();
     return;
   }
+
+  // The leveldb is only kept open if the ruleset could not be produced.
+  if (HTTPSEverywhereRuleset::Build(level_db_, ruleset_path))
+    ruleset = HTTPSEverywhereRuleset::Load(ruleset_path);
+  if (!ruleset) {
+    LOG(ERROR) << "Failed to load HTTPSE ruleset "
+               << ruleset_path.value().c_str();
+    return;
+  }
+
+  OnRulesetLoaded(std::move(ruleset));
+}
+
+void HTTPSEverywhereService::OnRulesetLoaded(
+    std::unique_ptr<HTTPSEverywhereRuleset> ruleset) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  CloseDatabase();
+  ruleset_ = std::move(ruleset);
+  // Results cached against the previous rules may be stale.
+  recently_used_cache_.clear();
 }
 
 void HTTPSEverywhereService::OnComponentReady(
@@ -163,14 +205,19 @@ bool HTTPSEverywhereService::GetHTTPSURL(
   if (!url->is_valid())
     return false;
 
-  if (!IsInitialized() || !level_db_ || url->scheme() == url::kHttpsScheme) {
+  if (!IsInitialized() || (!ruleset_ && !level_db_) ||
+      url->scheme() == url::kHttpsScheme) {
     return false;
   }
   if (!ShouldHTTPSERedirect(request_identifier)) {
     return false;
   }
 
-  if (recently_used_cache_.get(url->spec(), new_url)) {
+  const std::string host = url->host();
+  if (recently_used_cache_.is_no_rules_host(host))
+    return false;
+
+  if (recently_used_cache_.get(host, url->spec(), new_url)) {
     AddHTTPSEUrlToRedirectList(request_identifier);
     return true;
   }
@@ -184,18 +231,30 @@ bool HTTPSEverywhereService::GetHTTPSURL(
 
   const std::vector<std::string> domains =
       ExpandDomainForLookup(candidate_url.host());
+  bool has_rules = false;
   for (auto domain : domains) {
-    std::string value = leveldbGet(level_db_, domain);
-    if (!value.empty()) {
+    if (ruleset_) {
+      if (!ruleset_->HasRules(domain))
+        continue;
+      *new_url = ruleset_->ApplyRules(domain, candidate_url.spec());
+    } else {
+      std::string value = leveldbGet(level_db_, domain);
+      if (value.empty())
+        continue;
       *new_url = ApplyHTTPSRule(candidate_url.spec(), value);
-      if (0 != new_url->length()) {
-        recently_used_cache_.add(candidate_url.spec(), *new_url);
-        AddHTTPSEUrlToRedirectList(request_identifier);
-        return true;
-      }
     }
+    has_rules = true;
+    if (0 != new_url->length()) {
+      recently_used_cache_.add(host, candidate_url.spec(), *new_url);
+      AddHTTPSEUrlToRedirectList(request_identifier);
+      return true;
+    }
+  }
+  if (!has_rules) {
+    recently_used_cache_.add_no_rules_host(host);
+  } else {
+    recently_used_cache_.remove(host, candidate_url.spec());
   }
-  recently_used_cache_.remove(candidate_url.spec());
   return false;
 }
 
@@ -213,7 +272,13 @@ bool HTTPSEverywhereService::GetHTTPSURLFromCacheOnly(
     return false;
   }
 
-  if (recently_used_cache_.get(url->spec(), cached_url)) {
+  const std::string host = url->host();
+  if (recently_used_cache_.is_no_rules_host(host)) {
+    cached_url->clear();
+    return true;
+  }
+
+  if (recently_used_cache_.get(host, url->spec(), cached_url)) {
     AddHTTPSEUrlToRedirectList(request_identifier);
     return true;
   }
@@ -222,44 +287,14 @@ bool HTTPSEverywhereService::GetHTTPSURLFromCacheOnly(
 
 bool HTTPSEverywhereService::ShouldHTTPSERedirect(
     const uint64_t& request_identifier) {
-  base::AutoLock auto_lock(httpse_get_urls_redirects_count_mutex_);
-  for (size_t i = 0; i < httpse_urls_redirects_count_.size(); i++) {
-    if (request_identifier ==
-        httpse_urls_redirects_count_[i].request_identifier_ &&
-        httpse_urls_redirects_count_[i].redirects_ >=
-        HTTPSE_URL_MAX_REDIRECTS_COUNT - 1) {
-      return false;
-    }
-  }
-
-  return true;
+  return redirect_tracker_.GetRedirects(request_identifier) <
+         HTTPSE_URL_MAX_REDIRECTS_COUNT - 1;
 }
 
 void HTTPSEverywhereService::AddHTTPSEUrlToRedirectList(
     const uint64_t& request_identifier) {
   // Adding redirects count for the current request
-  base::AutoLock auto_lock(httpse_get_urls_redirects_count_mutex_);
-  bool hostFound = false;
-  for (size_t i = 0; i < httpse_urls_redirects_count_.size(); i++) {
-    if (request_identifier ==
-        httpse_urls_redirects_count_[i].request_identifier_) {
-      // Found the host, just increment the redirects_count
-      httpse_urls_redirects_count_[i].redirects_++;
-      hostFound = true;
-      break;
-    }
-  }
-  if (!hostFound) {
-      // The host is new, adding it to the redirects list
-      if (httpse_urls_redirects_count_.size() >=
-          HTTPSE_URLS_REDIRECTS_COUNT_QUEUE) {
-          // The queue is full, erase the first element
-          httpse_urls_redirects_count_.erase(
-              httpse_urls_redirects_count_.begin());
-      }
-      httpse_urls_redirects_count_.push_back(
-          HTTPSE_REDIRECTS_COUNT_ST(request_identifier, 1));
-  }
+  redirect_tracker_.AddRedirect(request_identifier);
 }
 
 std::string HTTPSEverywhereService::ApplyHTTPSRule(
@@ -380,6 +415,7 @@ void HTTPSEverywhereService::CloseDatabase() {
     delete level_db_;
     level_db_ = nullptr;
   }
+  ruleset_.reset();
 }
 
 // static
@@ -13,36 +13,27 @@
 #include "base/files/file_path.h"
 #include "base/memory/weak_ptr.h"
 #include "base/sequence_checker.h"
-#include "base/synchronization/lock.h"
 #include "brave/components/brave_shields/browser/base_brave_shields_service.h"
 #include "brave/components/brave_shields/browser/https_everywhere_recently_used_cache.h"
+#include "brave/components/brave_shields/browser/https_everywhere_redirect_tracker.h"
 
 namespace leveldb {
 class DB;
 }
 
 class HTTPSEverywhereServiceTest;
+class HTTPSEverywhereRulesetTest;
 
 using brave_component_updater::BraveComponent;
 
 namespace brave_shields {
 
+class HTTPSEverywhereRuleset;
+
 extern const char kHTTPSEverywhereComponentName[];
 extern const char kHTTPSEverywhereComponentId[];
 extern const char kHTTPSEverywhereComponentBase64PublicKey[];
 
-struct HTTPSE_REDIRECTS_COUNT_ST {
- public:
-  HTTPSE_REDIRECTS_COUNT_ST(uint64_t request_identifier,
-                            unsigned int redirects):
-    request_identifier_(request_identifier),
-    redirects_(redirects) {
-  }
-
-  uint64_t request_identifier_;
-  unsigned int redirects_;
-};
-
 class HTTPSEverywhereService : public BaseBraveShieldsService,
                          public base::SupportsWeakPtr<HTTPSEverywhereService> {
  public:
@@ -51,6 +42,8 @@ class HTTPSEverywhereService : public BaseBraveShieldsService,
   bool GetHTTPSURL(const GURL* url,
                    const uint64_t& request_id,
                    std::string* new_url);
+  // Returns true if the cache alone decided the outcome for |url|, in which
+  // case |cached_url| is left empty when the host has no rules.
   bool GetHTTPSURLFromCacheOnly(const GURL* url,
                                 const uint64_t& request_id,
                                 std::string* cached_url);
@@ -69,6 +62,7 @@ class HTTPSEverywhereService : public BaseBraveShieldsService,
 
  private:
   friend class ::HTTPSEverywhereServiceTest;
+  friend class ::HTTPSEverywhereRulesetTest;
   static bool g_ignore_port_for_test_;
   static std::string g_https_everywhere_component_id_;
   static std::string g_https_everywhere_component_base64_public_key_;
@@ -80,11 +74,13 @@ class HTTPSEverywhereService : public BaseBraveShieldsService,
   void CloseDatabase();
 
   void InitDB(const base::FilePath& install_dir);
+  // Serves lookups from |ruleset| and closes the database, if open.
+  void OnRulesetLoaded(std::unique_ptr<HTTPSEverywhereRuleset> ruleset);
 
-  base::Lock httpse_get_urls_redirects_count_mutex_;
-  std::vector<HTTPSE_REDIRECTS_COUNT_ST> httpse_urls_redirects_count_;
+  HTTPSERedirectTracker redirect_tracker_;
   HTTPSERecentlyUsedCache<std::string> recently_used_cache_;
   leveldb::DB* level_db_;
+  std::unique_ptr<HTTPSEverywhereRuleset> ruleset_;
 
   SEQUENCE_CHECKER(sequence_checker_);
   DISALLOW_COPY_AND_ASSIGN(HTTPSEverywhereService);
@@ -14,5 +14,46 @@ const base::Feature kBraveAdblockCosmeticFiltering{
     "BraveAdblockCosmeticFiltering",
     base::FEATURE_ENABLED_BY_DEFAULT};
 
+// Only used to carry the CNAME cache parameters below. ResolveHost does not
+// report record TTLs, so every canonical name is kept for the fixed
+// |ttl_seconds| after it was resolved, and at most |size| hosts are kept.
+const base::Feature kBraveAdblockCnameCache{
+    "BraveAdblockCnameCache",
+    base::FEATURE_ENABLED_BY_DEFAULT};
+
+const base::FeatureParam<int> kBraveAdblockCnameCacheSize{
+    &kBraveAdblockCnameCache, "size", 1000};
+const base::FeatureParam<int> kBraveAdblockCnameCacheTtlSeconds{
+    &kBraveAdblockCnameCache, "ttl_seconds", 60};
+
+// Matches the request URL while its CNAME is being resolved instead of
+// waiting for the resolution, the canonical name is only matched afterwards
+// when the request URL was neither blocked nor excepted.
+const base::Feature kBraveAdblockCnameParallelCheck{
+    "BraveAdblockCnameParallelCheck",
+    base::FEATURE_DISABLED_BY_DEFAULT};
+
+// Spreads ad block checks over a pool of matching sequences that share the
+// published engines read-only, instead of matching every request on the
+// adblock task runner. A |sequences| value of 0 uses one sequence per core.
+const base::Feature kBraveAdblockParallelMatching{
+    "BraveAdblockParallelMatching",
+    base::FEATURE_DISABLED_BY_DEFAULT};
+
+const base::FeatureParam<int> kBraveAdblockParallelMatchingSequences{
+    &kBraveAdblockParallelMatching, "sequences", 0};
+
+// Only used to carry the cache sizing parameters below.
+const base::Feature kBraveHTTPSEverywhereCache{
+    "BraveHTTPSEverywhereCache",
+    base::FEATURE_ENABLED_BY_DEFAULT};
+
+const base::FeatureParam<int> kBraveHTTPSEverywhereCacheSize{
+    &kBraveHTTPSEverywhereCache, "size", 1000};
+const base::FeatureParam<int> kBraveHTTPSEverywhereNegativeCacheSize{
+    &kBraveHTTPSEverywhereCache, "negative_size", 1000};
+const base::FeatureParam<int> kBraveHTTPSEverywhereCacheShards{
+    &kBraveHTTPSEverywhereCache, "shards", 16};
+
 }  // namespace features
 }  // namespace brave_shields
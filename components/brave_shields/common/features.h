@@ -6,13 +6,21 @@
 #ifndef BRAVE_COMPONENTS_BRAVE_SHIELDS_COMMON_FEATURES_H_
 #define BRAVE_COMPONENTS_BRAVE_SHIELDS_COMMON_FEATURES_H_
 
-namespace base {
-struct Feature;
-}  // namespace base
+#include "base/metrics/field_trial_params.h"
 
 namespace brave_shields {
 namespace features {
 extern const base::Feature kBraveAdblockCosmeticFiltering;
+extern const base::Feature kBraveAdblockCnameCache;
+extern const base::FeatureParam<int> kBraveAdblockCnameCacheSize;
+extern const base::FeatureParam<int> kBraveAdblockCnameCacheTtlSeconds;
+extern const base::Feature kBraveAdblockCnameParallelCheck;
+extern const base::Feature kBraveAdblockParallelMatching;
+extern const base::FeatureParam<int> kBraveAdblockParallelMatchingSequences;
+extern const base::Feature kBraveHTTPSEverywhereCache;
+extern const base::FeatureParam<int> kBraveHTTPSEverywhereCacheSize;
+extern const base::FeatureParam<int> kBraveHTTPSEverywhereNegativeCacheSize;
+extern const base::FeatureParam<int> kBraveHTTPSEverywhereCacheShards;
 }  // namespace features
 }  // namespace brave_shields
 
@@ -0,0 +1,101 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/challenge_bypass_ristretto/token_crypto_worker.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "base/threading/sequenced_task_runner_handle.h"
+
+namespace brave {
+
+using challenge_bypass_ristretto::Token;
+
+BlindedTokenBatch::BlindedTokenBatch() = default;
+
+BlindedTokenBatch::BlindedTokenBatch(BlindedTokenBatch&& other) = default;
+
+BlindedTokenBatch& BlindedTokenBatch::operator=(
+    BlindedTokenBatch&& other) = default;
+
+BlindedTokenBatch::~BlindedTokenBatch() = default;
+
+BlindedTokenBatch GenerateAndBlindTokens(size_t count) {
+  BlindedTokenBatch batch;
+  batch.tokens.reserve(count);
+  batch.blinded_tokens.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    Token token = Token::random();
+    batch.blinded_tokens.push_back(token.blind());
+    batch.tokens.push_back(std::move(token));
+  }
+
+  return batch;
+}
+
+const size_t TokenCryptoWorker::kTokensPerTask;
+
+TokenCryptoWorker::TokenCryptoWorker() {
+  if (base::SequencedTaskRunnerHandle::IsSet()) {
+    task_runner_ = base::SequencedTaskRunnerHandle::Get();
+  }
+}
+
+TokenCryptoWorker::~TokenCryptoWorker() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+}
+
+void TokenCryptoWorker::GenerateAndBlindTokens(
+    size_t count,
+    GenerateAndBlindTokensCallback callback) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (!task_runner_) {
+    BlindedTokenBatch batch = brave::GenerateAndBlindTokens(count);
+    if (challenge_bypass_ristretto::exception_occurred()) {
+      batch = BlindedTokenBatch();
+    }
+    std::move(callback).Run(std::move(batch));
+    return;
+  }
+
+  BlindedTokenBatch batch;
+  batch.tokens.reserve(count);
+  batch.blinded_tokens.reserve(count);
+  task_runner_->PostTask(
+      FROM_HERE, base::BindOnce(&TokenCryptoWorker::GenerateNextTokens,
+                                weak_factory_.GetWeakPtr(), count,
+                                std::move(batch), std::move(callback)));
+}
+
+void TokenCryptoWorker::GenerateNextTokens(
+    size_t count,
+    BlindedTokenBatch batch,
+    GenerateAndBlindTokensCallback callback) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  const size_t task_size =
+      std::min(kTokensPerTask, count - batch.tokens.size());
+  BlindedTokenBatch part = brave::GenerateAndBlindTokens(task_size);
+  if (challenge_bypass_ristretto::exception_occurred()) {
+    std::move(callback).Run(BlindedTokenBatch());
+    return;
+  }
+
+  std::move(part.tokens.begin(), part.tokens.end(),
+            std::back_inserter(batch.tokens));
+  std::move(part.blinded_tokens.begin(), part.blinded_tokens.end(),
+            std::back_inserter(batch.blinded_tokens));
+  if (batch.tokens.size() == count) {
+    std::move(callback).Run(std::move(batch));
+    return;
+  }
+
+  task_runner_->PostTask(
+      FROM_HERE, base::BindOnce(&TokenCryptoWorker::GenerateNextTokens,
+                                weak_factory_.GetWeakPtr(), count,
+                                std::move(batch), std::move(callback)));
+}
+
+}  // namespace brave
@@ -0,0 +1,105 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_COMPONENTS_CHALLENGE_BYPASS_RISTRETTO_TOKEN_CRYPTO_WORKER_H_
+#define BRAVE_COMPONENTS_CHALLENGE_BYPASS_RISTRETTO_TOKEN_CRYPTO_WORKER_H_
+
+#include <stddef.h>
+
+#include <utility>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/location.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/sequence_checker.h"
+#include "base/sequenced_task_runner.h"
+
+#include "wrapper.hpp"
+
+namespace brave {
+
+struct BlindedTokenBatch {
+  BlindedTokenBatch();
+  BlindedTokenBatch(BlindedTokenBatch&& other);
+  BlindedTokenBatch& operator=(BlindedTokenBatch&& other);
+  ~BlindedTokenBatch();
+
+  std::vector<challenge_bypass_ristretto::Token> tokens;
+  std::vector<challenge_bypass_ristretto::BlindedToken> blinded_tokens;
+};
+
+// Generates and blinds |count| tokens on the calling thread. Callers check the
+// library's last exception afterwards.
+BlindedTokenBatch GenerateAndBlindTokens(size_t count);
+
+// Runs challenge bypass token operations in short tasks on the sequence the
+// worker was created on, so large batches do not hold up other work on that
+// sequence for long. The library reports errors through one process-wide last
+// exception, which the rewards and ads code also reads after its own calls, so
+// every call into the library stays on that one sequence. Replies are dropped
+// once the worker is destroyed. Without a task runner, work runs inline.
+class TokenCryptoWorker {
+ public:
+  using GenerateAndBlindTokensCallback =
+      base::OnceCallback<void(BlindedTokenBatch)>;
+
+  // Batches larger than this are generated over several tasks of this many
+  // tokens.
+  static const size_t kTokensPerTask = 32;
+
+  TokenCryptoWorker();
+  ~TokenCryptoWorker();
+
+  TokenCryptoWorker(const TokenCryptoWorker&) = delete;
+  TokenCryptoWorker& operator=(const TokenCryptoWorker&) = delete;
+
+  // Replies with an empty batch if the library reports an error.
+  void GenerateAndBlindTokens(size_t count,
+                              GenerateAndBlindTokensCallback callback);
+
+  // Runs |task|, which may report errors through the library's last
+  // exception, in its own task, then passes its result to |reply|. A batch
+  // proof covers the whole batch, so |task| is not split.
+  template <typename R>
+  void RunVerificationTask(base::OnceCallback<R()> task,
+                           base::OnceCallback<void(R)> reply) {
+    DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+    if (!task_runner_) {
+      std::move(reply).Run(std::move(task).Run());
+      return;
+    }
+
+    task_runner_->PostTask(
+        FROM_HERE,
+        base::BindOnce(&TokenCryptoWorker::OnRunVerificationTask<R>,
+                       weak_factory_.GetWeakPtr(), std::move(task),
+                       std::move(reply)));
+  }
+
+ private:
+  template <typename R>
+  void OnRunVerificationTask(base::OnceCallback<R()> task,
+                             base::OnceCallback<void(R)> reply) {
+    DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+    std::move(reply).Run(std::move(task).Run());
+  }
+
+  void GenerateNextTokens(size_t count,
+                          BlindedTokenBatch batch,
+                          GenerateAndBlindTokensCallback callback);
+
+  scoped_refptr<base::SequencedTaskRunner> task_runner_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+
+  base::WeakPtrFactory<TokenCryptoWorker> weak_factory_{this};
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_COMPONENTS_CHALLENGE_BYPASS_RISTRETTO_TOKEN_CRYPTO_WORKER_H_
@@ -0,0 +1,104 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/challenge_bypass_ristretto/token_crypto_worker.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "base/run_loop.h"
+#include "base/test/task_environment.h"
+#include "base/threading/sequenced_task_runner_handle.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+// npm run test -- brave_perftests --filter=TokenCryptoWorkerPerfTest.*
+
+using challenge_bypass_ristretto::BlindedToken;
+using challenge_bypass_ristretto::Token;
+
+namespace brave {
+
+namespace {
+
+// Several hundred tokens, as in a large promotion refill.
+const size_t kRefillTokens = 500;
+
+// Reposts itself on the current sequence until |done| is set, and records the
+// longest time between two of its runs, which is how long the sequence was
+// unavailable to other tasks.
+struct SequenceProbe {
+  void Run() {
+    const base::TimeTicks now = base::TimeTicks::Now();
+    longest_gap = std::max(longest_gap, now - last_run);
+    last_run = now;
+    if (done)
+      return;
+
+    base::SequencedTaskRunnerHandle::Get()->PostTask(
+        FROM_HERE,
+        base::BindOnce(&SequenceProbe::Run, base::Unretained(this)));
+  }
+
+  base::TimeTicks last_run = base::TimeTicks::Now();
+  base::TimeDelta longest_gap;
+  bool done = false;
+};
+
+}  // namespace
+
+// Generates and blinds a large refill one token at a time on the calling
+// sequence, then through the worker, and reports how long each takes and the
+// longest time the calling sequence is blocked.
+TEST(TokenCryptoWorkerPerfTest, Refill) {
+  base::test::TaskEnvironment task_environment;
+
+  base::ElapsedTimer serial_timer;
+  std::vector<Token> tokens;
+  std::vector<BlindedToken> blinded_tokens;
+  for (size_t i = 0; i < kRefillTokens; i++) {
+    tokens.push_back(Token::random());
+  }
+  for (size_t i = 0; i < tokens.size(); i++) {
+    Token token = tokens.at(i);
+    blinded_tokens.push_back(token.blind());
+  }
+  base::TimeDelta serial_elapsed = serial_timer.Elapsed();
+  ASSERT_FALSE(challenge_bypass_ristretto::exception_occurred());
+  ASSERT_EQ(kRefillTokens, blinded_tokens.size());
+
+  TokenCryptoWorker worker;
+  SequenceProbe probe;
+  size_t generated = 0;
+  base::RunLoop run_loop;
+  base::ElapsedTimer worker_timer;
+  worker.GenerateAndBlindTokens(
+      kRefillTokens,
+      base::BindOnce(
+          [](size_t* generated, SequenceProbe* probe, base::OnceClosure quit,
+             BlindedTokenBatch batch) {
+            *generated = batch.blinded_tokens.size();
+            probe->done = true;
+            std::move(quit).Run();
+          },
+          &generated, &probe, run_loop.QuitClosure()));
+  probe.Run();
+  run_loop.Run();
+  base::TimeDelta worker_elapsed = worker_timer.Elapsed();
+  EXPECT_EQ(kRefillTokens, generated);
+
+  perf_test::PerfResultReporter reporter("TokenCryptoWorker", "refill");
+  reporter.RegisterImportantMetric(".serial_time", "ms");
+  reporter.RegisterImportantMetric(".worker_time", "ms");
+  reporter.RegisterImportantMetric(".worker_longest_sequence_block", "ms");
+  reporter.AddResult(".serial_time", serial_elapsed);
+  reporter.AddResult(".worker_time", worker_elapsed);
+  reporter.AddResult(".worker_longest_sequence_block", probe.longest_gap);
+}
+
+}  // namespace brave
@@ -0,0 +1,123 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/challenge_bypass_ristretto/token_crypto_worker.h"
+
+#include <memory>
+#include <utility>
+
+#include "base/run_loop.h"
+#include "base/sequenced_task_runner.h"
+#include "base/test/task_environment.h"
+#include "base/threading/sequenced_task_runner_handle.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+// npm run test -- brave_unit_tests --filter=TokenCryptoWorkerTest.*
+
+namespace brave {
+
+namespace {
+
+BlindedTokenBatch GenerateAndWait(TokenCryptoWorker* worker, size_t count) {
+  BlindedTokenBatch result;
+  base::RunLoop run_loop;
+  worker->GenerateAndBlindTokens(
+      count, base::BindOnce(
+                 [](BlindedTokenBatch* result, base::OnceClosure quit,
+                    BlindedTokenBatch batch) {
+                   *result = std::move(batch);
+                   std::move(quit).Run();
+                 },
+                 &result, run_loop.QuitClosure()));
+  run_loop.Run();
+  return result;
+}
+
+}  // namespace
+
+class TokenCryptoWorkerTest : public testing::Test {
+ protected:
+  base::test::TaskEnvironment task_environment_;
+};
+
+TEST_F(TokenCryptoWorkerTest, GenerateAndBlindTokens) {
+  TokenCryptoWorker worker;
+  for (size_t count : {1u, 32u, 33u, 100u}) {
+    BlindedTokenBatch batch = GenerateAndWait(&worker, count);
+    ASSERT_EQ(count, batch.tokens.size());
+    ASSERT_EQ(count, batch.blinded_tokens.size());
+    // Parts generated in separate tasks are put back together in order.
+    for (size_t i = 0; i < count; i++) {
+      EXPECT_EQ(batch.tokens[i].blind().encode_base64(),
+                batch.blinded_tokens[i].encode_base64());
+    }
+  }
+}
+
+TEST_F(TokenCryptoWorkerTest, GenerationYieldsToOtherTasks) {
+  TokenCryptoWorker worker;
+  bool other_task_ran = false;
+  bool other_task_ran_first = false;
+
+  base::RunLoop run_loop;
+  worker.GenerateAndBlindTokens(
+      100, base::BindOnce(
+               [](bool* other_task_ran, bool* other_task_ran_first,
+                  base::OnceClosure quit, BlindedTokenBatch batch) {
+                 *other_task_ran_first = *other_task_ran;
+                 std::move(quit).Run();
+               },
+               &other_task_ran, &other_task_ran_first,
+               run_loop.QuitClosure()));
+  base::SequencedTaskRunnerHandle::Get()->PostTask(
+      FROM_HERE, base::BindOnce([](bool* ran) { *ran = true; },
+                                &other_task_ran));
+  run_loop.Run();
+  EXPECT_TRUE(other_task_ran_first);
+}
+
+TEST_F(TokenCryptoWorkerTest, VerificationTaskRunsOnCallerSequence) {
+  TokenCryptoWorker worker;
+  scoped_refptr<base::SequencedTaskRunner> caller =
+      base::SequencedTaskRunnerHandle::Get();
+  bool ran = false;
+
+  base::RunLoop run_loop;
+  worker.RunVerificationTask(
+      base::BindOnce(
+          [](scoped_refptr<base::SequencedTaskRunner> caller, bool* ran) {
+            *ran = true;
+            return caller->RunsTasksInCurrentSequence();
+          },
+          caller, &ran),
+      base::BindOnce(
+          [](base::OnceClosure quit, bool ran_on_caller) {
+            EXPECT_TRUE(ran_on_caller);
+            std::move(quit).Run();
+          },
+          run_loop.QuitClosure()));
+  // The task runs asynchronously.
+  EXPECT_FALSE(ran);
+  run_loop.Run();
+  EXPECT_TRUE(ran);
+}
+
+TEST_F(TokenCryptoWorkerTest, RepliesAreDroppedWithTheWorker) {
+  auto worker = std::make_unique<TokenCryptoWorker>();
+  bool replied = false;
+  worker->GenerateAndBlindTokens(
+      100, base::BindOnce([](bool* replied,
+                             BlindedTokenBatch batch) { *replied = true; },
+                          &replied));
+  worker->RunVerificationTask(
+      base::BindOnce([]() { return 1; }),
+      base::BindOnce([](bool* replied, int result) { *replied = true; },
+                     &replied));
+  worker.reset();
+  task_environment_.RunUntilIdle();
+  EXPECT_FALSE(replied);
+}
+
+}  // namespace brave
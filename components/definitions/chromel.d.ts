@@ -291,8 +291,8 @@ declare namespace chrome.braveShields {
     force_hide_selectors: string[]
     generichide: boolean
   }
-  const urlCosmeticResources: (url: string, callback: (resources: UrlSpecificResources) => void) => void
-  const hiddenClassIdSelectors: (classes: string[], ids: string[], exceptions: string[], callback: (selectors: string[], forceHideSelectors: string[]) => void) => void
+  const urlCosmeticResources: (url: string, tabId: number | undefined, frameId: number | undefined, callback: (resources: UrlSpecificResources) => void) => void
+  const hiddenClassIdSelectors: (classes: string[], ids: string[], exceptions: string[], tabId: number | undefined, frameId: number | undefined, callback: (selectors: string[], forceHideSelectors: string[]) => void) => void
 
   type BraveShieldsViewPreferences = {
     showAdvancedView: boolean
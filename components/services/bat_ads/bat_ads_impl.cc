@@ -61,6 +61,16 @@ void BatAdsImpl::Shutdown(
   ads_->Shutdown(shutdown_callback);
 }
 
+void BatAdsImpl::CommitPendingWrites(
+    CommitPendingWritesCallback callback) {
+  auto* holder = new CallbackHolder<CommitPendingWritesCallback>(AsWeakPtr(),
+      std::move(callback));
+
+  auto commit_pending_writes_callback =
+      std::bind(BatAdsImpl::OnCommitPendingWrites, holder, _1);
+  ads_->CommitPendingWrites(commit_pending_writes_callback);
+}
+
 void BatAdsImpl::ChangeLocale(
     const std::string& locale) {
   ads_->ChangeLocale(locale);
@@ -265,6 +275,16 @@ void BatAdsImpl::OnShutdown(
   delete holder;
 }
 
+void BatAdsImpl::OnCommitPendingWrites(
+    CallbackHolder<CommitPendingWritesCallback>* holder,
+    const int32_t result) {
+  if (holder->is_valid()) {
+    std::move(holder->get()).Run((ads::Result)result);
+  }
+
+  delete holder;
+}
+
 void BatAdsImpl::OnRemoveAllHistory(
     CallbackHolder<RemoveAllHistoryCallback>* holder,
     const int32_t result) {
@@ -42,6 +42,9 @@ class BatAdsImpl :
   void Shutdown(
       ShutdownCallback callback) override;
 
+  void CommitPendingWrites(
+      CommitPendingWritesCallback callback) override;
+
   void ChangeLocale(
       const std::string& locale) override;
 
@@ -165,6 +168,10 @@ class BatAdsImpl :
       CallbackHolder<ShutdownCallback>* holder,
       const int32_t result);
 
+  static void OnCommitPendingWrites(
+      CallbackHolder<CommitPendingWritesCallback>* holder,
+      const int32_t result);
+
   static void OnRemoveAllHistory(
       CallbackHolder<RemoveAllHistoryCallback>* holder,
       const int32_t result);
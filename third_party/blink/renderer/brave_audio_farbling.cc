@@ -0,0 +1,112 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/third_party/blink/renderer/brave_audio_farbling.h"
+
+#include "build/build_config.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <emmintrin.h>
+#elif defined(ARCH_CPU_ARM64)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+const double kMaxUInt64AsDouble = UINT64_MAX;
+
+inline float NoiseFromSequence(uint64_t v) {
+  return (v / kMaxUInt64AsDouble) / 10;
+}
+
+}  // namespace
+
+namespace brave {
+
+void FarbleAudioBalanced(float* data, size_t count, double fudge_factor) {
+  size_t i = 0;
+#if defined(ARCH_CPU_X86_FAMILY)
+  const __m128d factor = _mm_set1_pd(fudge_factor);
+  for (; i + 4 <= count; i += 4) {
+    const __m128 samples = _mm_loadu_ps(data + i);
+    const __m128d low = _mm_mul_pd(_mm_cvtps_pd(samples), factor);
+    const __m128d high =
+        _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(samples, samples)), factor);
+    _mm_storeu_ps(data + i,
+                  _mm_movelh_ps(_mm_cvtpd_ps(low), _mm_cvtpd_ps(high)));
+  }
+#elif defined(ARCH_CPU_ARM64)
+  const float64x2_t factor = vdupq_n_f64(fudge_factor);
+  for (; i + 4 <= count; i += 4) {
+    const float32x4_t samples = vld1q_f32(data + i);
+    const float64x2_t low =
+        vmulq_f64(vcvt_f64_f32(vget_low_f32(samples)), factor);
+    const float64x2_t high = vmulq_f64(vcvt_high_f64_f32(samples), factor);
+    vst1q_f32(data + i, vcvt_high_f32_f64(vcvt_f32_f64(low), high));
+  }
+#endif
+  for (; i < count; ++i)
+    data[i] = data[i] * fudge_factor;
+}
+
+void FarbleAudioMaximum(float* data, size_t count, uint64_t seed) {
+  // Each value depends on the previous one, so the sequence is generated
+  // serially, but in registers rather than through a per-sample call.
+  uint64_t v = seed;
+  for (size_t i = 0; i < count; ++i) {
+    v = lfsr_next(v);
+    data[i] = NoiseFromSequence(v);
+  }
+}
+
+AudioFarblingHelper::AudioFarblingHelper()
+    : mode_(Mode::kOff), fudge_factor_(1.0), seed_(0), sequence_(0) {}
+
+// static
+AudioFarblingHelper AudioFarblingHelper::CreateBalanced(double fudge_factor) {
+  AudioFarblingHelper helper;
+  helper.mode_ = Mode::kBalanced;
+  helper.fudge_factor_ = fudge_factor;
+  return helper;
+}
+
+// static
+AudioFarblingHelper AudioFarblingHelper::CreateMaximum(uint64_t seed) {
+  AudioFarblingHelper helper;
+  helper.mode_ = Mode::kMaximum;
+  helper.seed_ = seed;
+  helper.sequence_ = seed;
+  return helper;
+}
+
+void AudioFarblingHelper::FarbleAudioChannel(float* data, size_t count) const {
+  switch (mode_) {
+    case Mode::kOff:
+      break;
+    case Mode::kBalanced:
+      FarbleAudioBalanced(data, count, fudge_factor_);
+      break;
+    case Mode::kMaximum:
+      FarbleAudioMaximum(data, count, seed_);
+      break;
+  }
+}
+
+float AudioFarblingHelper::FarbleSample(float value, size_t index) {
+  switch (mode_) {
+    case Mode::kOff:
+      return value;
+    case Mode::kBalanced:
+      return value * fudge_factor_;
+    case Mode::kMaximum:
+      if (index == 0)
+        sequence_ = seed_;
+      sequence_ = lfsr_next(sequence_);
+      return NoiseFromSequence(sequence_);
+  }
+  return value;
+}
+
+}  // namespace brave
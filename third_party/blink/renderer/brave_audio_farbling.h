@@ -0,0 +1,59 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_THIRD_PARTY_BLINK_RENDERER_BRAVE_AUDIO_FARBLING_H_
+#define BRAVE_THIRD_PARTY_BLINK_RENDERER_BRAVE_AUDIO_FARBLING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace brave {
+
+inline uint64_t lfsr_next(uint64_t v) {
+  const uint64_t zero = 0;
+  return ((v >> 1) | (((v << 62) ^ (v << 61)) & (~(~zero << 63) << 62)));
+}
+
+// Multiplies the |count| samples of |data| by |fudge_factor|. Products are
+// computed in double precision, as a per-sample multiply would.
+void FarbleAudioBalanced(float* data, size_t count, double fudge_factor);
+
+// Replaces the |count| samples of |data| with pseudo-random values between 0
+// and 0.1, taken from the LFSR sequence that starts at |seed|.
+void FarbleAudioMaximum(float* data, size_t count, uint64_t seed);
+
+// Farbles audio data for one farbling level. Copies are cheap and each copy
+// keeps its own sequence, so no state is shared between callers.
+class AudioFarblingHelper {
+ public:
+  // Leaves samples untouched.
+  AudioFarblingHelper();
+
+  static AudioFarblingHelper CreateBalanced(double fudge_factor);
+  static AudioFarblingHelper CreateMaximum(uint64_t seed);
+
+  explicit operator bool() const { return mode_ != Mode::kOff; }
+
+  // Farbles |count| samples of |data| in place, |data| being the start of the
+  // sequence.
+  void FarbleAudioChannel(float* data, size_t count) const;
+
+  // Farbles the sample at |index| of a sequence that starts over at index 0,
+  // for callers that only see one sample at a time. Samples must be passed
+  // in order.
+  float FarbleSample(float value, size_t index);
+
+ private:
+  enum class Mode { kOff, kBalanced, kMaximum };
+
+  Mode mode_;
+  double fudge_factor_;
+  uint64_t seed_;
+  uint64_t sequence_;
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_THIRD_PARTY_BLINK_RENDERER_BRAVE_AUDIO_FARBLING_H_
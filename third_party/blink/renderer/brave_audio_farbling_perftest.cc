@@ -0,0 +1,109 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/third_party/blink/renderer/brave_audio_farbling.h"
+
+#include <vector>
+
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/timer/elapsed_timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+// npm run test -- brave_perftests --filter=BraveAudioFarblingPerfTest.*
+
+namespace {
+
+const double kFudgeFactor = 0.99 + 0.0042;
+const uint64_t kSeed = 0x123456789abcdef0;
+// A long AudioBuffer channel, and the largest analyser FFT size.
+const size_t kBufferSamples = 4 * 1024 * 1024;
+const size_t kAnalyserFrameSamples = 32768;
+const int kAnalyserFrames = 128;
+
+// The per-sample callbacks farbling used to be applied with.
+float ConstantMultiplier(double fudge_factor, float value, size_t index) {
+  return value * fudge_factor;
+}
+
+float PseudoRandomSequence(uint64_t seed,
+                           uint64_t* v,
+                           float value,
+                           size_t index) {
+  const double maxUInt64AsDouble = UINT64_MAX;
+  if (index == 0)
+    *v = seed;
+  *v = brave::lfsr_next(*v);
+  return (*v / maxUInt64AsDouble) / 10;
+}
+
+std::vector<float> MakeSamples(size_t count) {
+  std::vector<float> samples(count);
+  for (size_t i = 0; i < count; ++i)
+    samples[i] = static_cast<float>(i % 2001) / 1000 - 1;
+  return samples;
+}
+
+void RunCallback(
+    const base::RepeatingCallback<float(float, size_t)>& callback,
+    std::vector<float>* samples) {
+  float* data = samples->data();
+  for (size_t i = 0; i < samples->size(); ++i)
+    data[i] = callback.Run(data[i], i);
+}
+
+}  // namespace
+
+// Compares the per-sample callbacks with the block kernels on one large
+// AudioBuffer channel and on a series of analyser frames.
+TEST(BraveAudioFarblingPerfTest, Kernels) {
+  uint64_t v = 0;
+  const struct {
+    const char* name;
+    base::RepeatingCallback<float(float, size_t)> callback;
+    brave::AudioFarblingHelper helper;
+  } levels[] = {
+      {"balanced", base::BindRepeating(&ConstantMultiplier, kFudgeFactor),
+       brave::AudioFarblingHelper::CreateBalanced(kFudgeFactor)},
+      {"maximum", base::BindRepeating(&PseudoRandomSequence, kSeed, &v),
+       brave::AudioFarblingHelper::CreateMaximum(kSeed)},
+  };
+
+  for (const auto& level : levels) {
+    std::vector<float> by_callback = MakeSamples(kBufferSamples);
+    std::vector<float> by_kernel = by_callback;
+
+    base::ElapsedTimer callback_timer;
+    RunCallback(level.callback, &by_callback);
+    base::TimeDelta callback_buffer = callback_timer.Elapsed();
+
+    base::ElapsedTimer kernel_timer;
+    level.helper.FarbleAudioChannel(by_kernel.data(), by_kernel.size());
+    base::TimeDelta kernel_buffer = kernel_timer.Elapsed();
+    EXPECT_EQ(by_callback, by_kernel);
+
+    std::vector<float> frame = MakeSamples(kAnalyserFrameSamples);
+    callback_timer = base::ElapsedTimer();
+    for (int i = 0; i < kAnalyserFrames; ++i)
+      RunCallback(level.callback, &frame);
+    base::TimeDelta callback_frame = callback_timer.Elapsed() / kAnalyserFrames;
+
+    kernel_timer = base::ElapsedTimer();
+    for (int i = 0; i < kAnalyserFrames; ++i)
+      level.helper.FarbleAudioChannel(frame.data(), frame.size());
+    base::TimeDelta kernel_frame = kernel_timer.Elapsed() / kAnalyserFrames;
+
+    perf_test::PerfResultReporter reporter("BraveAudioFarbling", level.name);
+    reporter.RegisterImportantMetric(".buffer_callback", "us");
+    reporter.RegisterImportantMetric(".buffer_kernel", "us");
+    reporter.RegisterImportantMetric(".analyser_frame_callback", "us");
+    reporter.RegisterImportantMetric(".analyser_frame_kernel", "us");
+    reporter.AddResult(".buffer_callback", callback_buffer);
+    reporter.AddResult(".buffer_kernel", kernel_buffer);
+    reporter.AddResult(".analyser_frame_callback", callback_frame);
+    reporter.AddResult(".analyser_frame_kernel", kernel_frame);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,119 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/third_party/blink/renderer/brave_audio_farbling.h"
+
+#include <vector>
+
+#include "base/bind.h"
+#include "base/callback.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+// npm run test -- brave_unit_tests --filter=BraveAudioFarblingTest.*
+
+namespace {
+
+const double kFudgeFactor = 0.99 + 0.0042;
+const uint64_t kSeed = 0x123456789abcdef0;
+
+// The per-sample callbacks farbling used to be applied with, kept as the
+// reference the kernels must reproduce exactly.
+float ConstantMultiplier(double fudge_factor, float value, size_t index) {
+  return value * fudge_factor;
+}
+
+float PseudoRandomSequence(uint64_t seed,
+                           uint64_t* v,
+                           float value,
+                           size_t index) {
+  const double maxUInt64AsDouble = UINT64_MAX;
+  if (index == 0)
+    *v = seed;
+  *v = brave::lfsr_next(*v);
+  return (*v / maxUInt64AsDouble) / 10;
+}
+
+std::vector<float> MakeSamples(size_t count) {
+  std::vector<float> samples(count);
+  for (size_t i = 0; i < count; ++i)
+    samples[i] = static_cast<float>(i % 2001) / 1000 - 1;
+  return samples;
+}
+
+void RunCallback(
+    const base::RepeatingCallback<float(float, size_t)>& callback,
+    std::vector<float>* samples) {
+  float* data = samples->data();
+  for (size_t i = 0; i < samples->size(); ++i)
+    data[i] = callback.Run(data[i], i);
+}
+
+}  // namespace
+
+TEST(BraveAudioFarblingTest, BalancedMatchesPerSampleMultiply) {
+  // Odd sizes exercise the scalar tail after the vector loop.
+  for (size_t count : {0u, 1u, 3u, 4u, 7u, 1027u}) {
+    std::vector<float> expected = MakeSamples(count);
+    RunCallback(base::BindRepeating(&ConstantMultiplier, kFudgeFactor),
+                &expected);
+
+    std::vector<float> actual = MakeSamples(count);
+    brave::AudioFarblingHelper::CreateBalanced(kFudgeFactor)
+        .FarbleAudioChannel(actual.data(), actual.size());
+    EXPECT_EQ(expected, actual);
+  }
+}
+
+TEST(BraveAudioFarblingTest, MaximumMatchesPerSampleSequence) {
+  uint64_t v = 0;
+  std::vector<float> expected = MakeSamples(1027);
+  RunCallback(base::BindRepeating(&PseudoRandomSequence, kSeed, &v),
+              &expected);
+
+  brave::AudioFarblingHelper helper =
+      brave::AudioFarblingHelper::CreateMaximum(kSeed);
+  std::vector<float> actual = MakeSamples(1027);
+  helper.FarbleAudioChannel(actual.data(), actual.size());
+  EXPECT_EQ(expected, actual);
+
+  // Every call starts the sequence over.
+  std::vector<float> again = MakeSamples(1027);
+  helper.FarbleAudioChannel(again.data(), again.size());
+  EXPECT_EQ(expected, again);
+
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_GE(actual[i], 0);
+    EXPECT_LE(actual[i], 0.1f);
+  }
+}
+
+TEST(BraveAudioFarblingTest, FarbleSampleMatchesChannel) {
+  std::vector<float> expected = MakeSamples(64);
+  brave::AudioFarblingHelper::CreateMaximum(kSeed).FarbleAudioChannel(
+      expected.data(), expected.size());
+
+  // Two helpers interleaving their sequences do not affect each other.
+  brave::AudioFarblingHelper first =
+      brave::AudioFarblingHelper::CreateMaximum(kSeed);
+  brave::AudioFarblingHelper second =
+      brave::AudioFarblingHelper::CreateMaximum(kSeed);
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i], first.FarbleSample(1, i));
+    EXPECT_EQ(expected[i], second.FarbleSample(1, i));
+  }
+  EXPECT_EQ(expected[0], first.FarbleSample(1, 0));
+}
+
+TEST(BraveAudioFarblingTest, OffLeavesSamplesUntouched) {
+  brave::AudioFarblingHelper helper;
+  EXPECT_FALSE(helper);
+  EXPECT_TRUE(brave::AudioFarblingHelper::CreateBalanced(kFudgeFactor));
+  EXPECT_TRUE(brave::AudioFarblingHelper::CreateMaximum(kSeed));
+
+  std::vector<float> samples = MakeSamples(16);
+  helper.FarbleAudioChannel(samples.data(), samples.size());
+  EXPECT_EQ(MakeSamples(16), samples);
+  EXPECT_EQ(0.5f, helper.FarbleSample(0.5f, 3));
+}
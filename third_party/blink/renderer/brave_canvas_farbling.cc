@@ -0,0 +1,53 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/third_party/blink/renderer/brave_canvas_farbling.h"
+
+#include "base/logging.h"
+#include "brave/third_party/blink/renderer/brave_audio_farbling.h"
+#include "crypto/hmac.h"
+#include "third_party/boringssl/src/include/openssl/siphash.h"
+
+namespace brave {
+
+uint64_t ComputeCanvasDigest(const uint64_t key[2],
+                             const uint8_t* pixels,
+                             size_t size) {
+  return SIPHASH_24(key, pixels, size);
+}
+
+void PerturbCanvasPixels(uint8_t* pixels,
+                         size_t pixel_count,
+                         uint8_t channel,
+                         uint64_t perturbation_key,
+                         uint64_t digest) {
+  DCHECK_GT(pixel_count, 0u);
+  DCHECK_LT(channel, 4);
+  // calculate initial seed to find first pixel to perturb, based on session
+  // key, domain key, and the digest of the canvas contents
+  crypto::HMAC h(crypto::HMAC::SHA256);
+  CHECK(h.Init(reinterpret_cast<const unsigned char*>(&perturbation_key),
+               sizeof perturbation_key));
+  uint8_t canvas_key[32];
+  CHECK(h.Sign(base::StringPiece(reinterpret_cast<const char*>(&digest),
+                                 sizeof digest),
+               canvas_key, sizeof canvas_key));
+  uint64_t v = *reinterpret_cast<uint64_t*>(canvas_key);
+  uint64_t pixel_index;
+  // iterate through 32-byte canvas key and use each bit to determine how to
+  // perturb the current pixel
+  for (int i = 0; i < 32; i++) {
+    uint8_t bit = canvas_key[i];
+    for (int j = 8; j >= 0; j--) {
+      pixel_index = 4 * (v % pixel_count) + channel;
+      pixels[pixel_index] = pixels[pixel_index] ^ (bit & 0x1);
+      bit = bit >> 1;
+      // find next pixel to perturb
+      v = lfsr_next(v);
+    }
+  }
+}
+
+}  // namespace brave
@@ -0,0 +1,114 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_THIRD_PARTY_BLINK_RENDERER_BRAVE_CANVAS_FARBLING_H_
+#define BRAVE_THIRD_PARTY_BLINK_RENDERER_BRAVE_CANVAS_FARBLING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <tuple>
+#include <utility>
+
+#include "base/containers/mru_cache.h"
+
+namespace brave {
+
+// Identifies the contents of a canvas readback.
+struct CanvasDigest {
+  bool operator<(const CanvasDigest& other) const {
+    return std::tie(hash, width, height) <
+           std::tie(other.hash, other.width, other.height);
+  }
+
+  uint64_t hash;
+  int width;
+  int height;
+};
+
+// Returns a SipHash-2-4 digest of the |size| bytes at |pixels| under |key|.
+uint64_t ComputeCanvasDigest(const uint64_t key[2],
+                             const uint8_t* pixels,
+                             size_t size);
+
+// Flips the low bit of |channel| in a pseudo-random set of the |pixel_count|
+// RGBA pixels at |pixels|, in place. The set only depends on
+// |perturbation_key| and on |digest|, the digest of the unperturbed pixels.
+void PerturbCanvasPixels(uint8_t* pixels,
+                         size_t pixel_count,
+                         uint8_t channel,
+                         uint64_t perturbation_key,
+                         uint64_t digest);
+
+// Keeps the most recently perturbed canvases, keyed by the digest of their
+// unperturbed contents, up to |max_bytes| of pixels. Only canvases read more
+// than once are kept. The owner calls Clear() under memory pressure.
+template <class T>
+class PerturbedCanvasCache {
+ public:
+  explicit PerturbedCanvasCache(size_t max_bytes)
+      : entries_(Entries::NO_AUTO_EVICT),
+        seen_(kMaxSeenDigests),
+        max_bytes_(max_bytes),
+        bytes_(0) {}
+
+  // Returns the cached result for |digest|, or nullptr.
+  const T* Get(const CanvasDigest& digest) {
+    auto it = entries_.Get(digest);
+    if (it == entries_.end())
+      return nullptr;
+    return &it->second.value;
+  }
+
+  // Caches |value|, which holds |bytes| of pixels, if |digest| was put before,
+  // evicting the least recently used results to stay within budget.
+  void Put(const CanvasDigest& digest, T value, size_t bytes) {
+    if (bytes > max_bytes_)
+      return;
+    if (seen_.Peek(digest) == seen_.end()) {
+      seen_.Put(digest, true);
+      return;
+    }
+    auto it = entries_.Peek(digest);
+    if (it != entries_.end()) {
+      bytes_ -= it->second.bytes;
+      entries_.Erase(it);
+    }
+    while (bytes_ + bytes > max_bytes_) {
+      auto last = entries_.rbegin();
+      bytes_ -= last->second.bytes;
+      entries_.Erase(last);
+    }
+    entries_.Put(digest, Entry{std::move(value), bytes});
+    bytes_ += bytes;
+  }
+
+  void Clear() {
+    entries_.Clear();
+    seen_.Clear();
+    bytes_ = 0;
+  }
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  // Digests of canvases read once, which are cached when read again.
+  static constexpr size_t kMaxSeenDigests = 16;
+
+  struct Entry {
+    T value;
+    size_t bytes;
+  };
+  using Entries = base::MRUCache<CanvasDigest, Entry>;
+
+  Entries entries_;
+  base::MRUCache<CanvasDigest, bool> seen_;
+  const size_t max_bytes_;
+  size_t bytes_;
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_THIRD_PARTY_BLINK_RENDERER_BRAVE_CANVAS_FARBLING_H_
@@ -0,0 +1,155 @@
+/* Copyright (c) 2020 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/third_party/blink/renderer/brave_canvas_farbling.h"
+
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "crypto/hmac.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+// npm run test -- brave_unit_tests --filter=BraveCanvasFarblingTest.*
+
+namespace {
+
+const uint64_t kSessionKey = 12345;
+const uint64_t kDigestKey[2] = {1, 2};
+
+using Pixels = std::vector<uint8_t>;
+
+Pixels MakeCanvas(int width, int height) {
+  Pixels pixels(4 * width * height);
+  for (size_t i = 0; i < pixels.size(); ++i)
+    pixels[i] = static_cast<uint8_t>(i * 7);
+  return pixels;
+}
+
+}  // namespace
+
+class BraveCanvasFarblingTest : public ::testing::Test {
+ protected:
+  // Puts |value| twice, since only repeated reads are cached.
+  void PutRepeated(brave::PerturbedCanvasCache<int>* cache,
+                   const brave::CanvasDigest& digest,
+                   int value,
+                   size_t bytes) {
+    cache->Put(digest, value, bytes);
+    cache->Put(digest, value, bytes);
+  }
+};
+
+TEST_F(BraveCanvasFarblingTest, DigestDependsOnKeyAndContents) {
+  Pixels pixels = MakeCanvas(16, 16);
+  const uint64_t digest =
+      brave::ComputeCanvasDigest(kDigestKey, pixels.data(), pixels.size());
+  EXPECT_EQ(digest, brave::ComputeCanvasDigest(kDigestKey, pixels.data(),
+                                               pixels.size()));
+
+  const uint64_t other_key[2] = {1, 3};
+  EXPECT_NE(digest, brave::ComputeCanvasDigest(other_key, pixels.data(),
+                                               pixels.size()));
+  // The whole buffer is hashed, not only its first bytes.
+  pixels.back() ^= 1;
+  EXPECT_NE(digest, brave::ComputeCanvasDigest(kDigestKey, pixels.data(),
+                                               pixels.size()));
+}
+
+// Same canvas, session token and site as the farbling browser tests.
+TEST_F(BraveCanvasFarblingTest, PerturbsBlankCanvas) {
+  uint8_t domain_key[32];
+  crypto::HMAC h(crypto::HMAC::SHA256);
+  ASSERT_TRUE(h.Init(reinterpret_cast<const unsigned char*>(&kSessionKey),
+                     sizeof kSessionKey));
+  ASSERT_TRUE(h.Sign("a.com", domain_key, sizeof domain_key));
+  const uint8_t channel = domain_key[0] % 3;
+  const uint64_t session_plus_domain_key =
+      kSessionKey ^ *reinterpret_cast<uint64_t*>(domain_key);
+  const uint64_t digest_key[2] = {
+      session_plus_domain_key, *reinterpret_cast<uint64_t*>(domain_key + 8)};
+
+  Pixels pixels(4 * 16 * 16);
+  const uint64_t digest =
+      brave::ComputeCanvasDigest(digest_key, pixels.data(), pixels.size());
+  brave::PerturbCanvasPixels(pixels.data(), 16 * 16, channel,
+                             session_plus_domain_key, digest);
+  EXPECT_EQ(92, std::accumulate(pixels.begin(), pixels.end(), 0));
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    if (i % 4 != channel)
+      EXPECT_EQ(0, pixels[i]);
+  }
+}
+
+TEST_F(BraveCanvasFarblingTest, CacheStaysWithinBudget) {
+  brave::PerturbedCanvasCache<int> cache(100);
+  const brave::CanvasDigest first = {1, 2, 3};
+  const brave::CanvasDigest second = {1, 3, 2};
+  const brave::CanvasDigest third = {2, 2, 3};
+
+  EXPECT_EQ(nullptr, cache.Get(first));
+  PutRepeated(&cache, first, 1, 40);
+  PutRepeated(&cache, second, 2, 40);
+  ASSERT_NE(nullptr, cache.Get(first));
+  EXPECT_EQ(1, *cache.Get(first));
+  ASSERT_NE(nullptr, cache.Get(second));
+  EXPECT_EQ(2, *cache.Get(second));
+
+  // |first| is the least recently used entry, and goes to make room.
+  PutRepeated(&cache, third, 3, 40);
+  EXPECT_EQ(nullptr, cache.Get(first));
+  EXPECT_EQ(2u, cache.size());
+
+  // Replacing an entry releases its bytes.
+  cache.Put(third, 4, 60);
+  ASSERT_NE(nullptr, cache.Get(third));
+  EXPECT_EQ(4, *cache.Get(third));
+  EXPECT_EQ(2u, cache.size());
+
+  // Results larger than the whole budget are not kept.
+  PutRepeated(&cache, first, 5, 101);
+  EXPECT_EQ(nullptr, cache.Get(first));
+  EXPECT_EQ(2u, cache.size());
+}
+
+TEST_F(BraveCanvasFarblingTest, CacheKeepsOnlyRepeatedReads) {
+  brave::PerturbedCanvasCache<Pixels> cache(4 * 64 * 64);
+  const Pixels canvas = MakeCanvas(64, 64);
+  const size_t pixel_count = 64 * 64;
+
+  int perturbations = 0;
+  for (int i = 0; i < 4; ++i) {
+    Pixels pixels = canvas;
+    const brave::CanvasDigest digest = {
+        brave::ComputeCanvasDigest(kDigestKey, pixels.data(), pixels.size()),
+        64, 64};
+    if (const Pixels* cached = cache.Get(digest)) {
+      EXPECT_NE(canvas, *cached);
+      continue;
+    }
+    brave::PerturbCanvasPixels(pixels.data(), pixel_count, 1, kSessionKey,
+                               digest.hash);
+    ++perturbations;
+    cache.Put(digest, std::move(pixels), 4 * pixel_count);
+  }
+  // The first read is not kept, the second one is and answers the others.
+  EXPECT_EQ(2, perturbations);
+  EXPECT_EQ(1u, cache.size());
+}
+
+TEST_F(BraveCanvasFarblingTest, ClearDropsEverything) {
+  brave::PerturbedCanvasCache<int> cache(100);
+  const brave::CanvasDigest digest = {1, 2, 3};
+  PutRepeated(&cache, digest, 1, 40);
+  ASSERT_NE(nullptr, cache.Get(digest));
+
+  cache.Clear();
+  EXPECT_EQ(nullptr, cache.Get(digest));
+  EXPECT_EQ(0u, cache.size());
+
+  // Reads seen before the purge count as first reads again.
+  cache.Put(digest, 2, 40);
+  EXPECT_EQ(nullptr, cache.Get(digest));
+}